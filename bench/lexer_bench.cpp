@@ -0,0 +1,98 @@
+// Measures the throughput of the lexer in MB/s.
+//
+// $ lexer_bench                 lexes a generated model of 128 MB
+// $ lexer_bench <file.picalc>   lexes the given model
+
+#include "picalc/lexer.hpp"
+#include "picalc/mappedfile.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+
+// A model in the style of the generated benchmarks: long sums of prefix
+// chains with names of different lengths, indentation and comments.
+static std::string generate_model(size_t size) {
+    const char* names[] = { "a", "b", "chan", "x_long_name", "reply_channel_0" };
+    uint64_t seed = 1;
+    auto random = [&](uint32_t bound) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(seed >> 33) % bound;
+    };
+
+    std::string result;
+    result.reserve(size + 4096);
+    for (size_t agent = 0; result.size() < size; agent++) {
+        if (agent % 16 == 0) {
+            result += "% agents " + std::to_string(agent) + " and on\n";
+        }
+        result += "agent Agent" + std::to_string(agent) + "(a, b, chan) =\n";
+        for (int summand = 0; summand < 4; summand++) {
+            result += summand == 0 ? "        " : "      + ";
+            for (int prefix = 0; prefix < 12; prefix++) {
+                auto subject = names[random(5)];
+                auto object = names[random(5)];
+                switch (random(4)) {
+                    case 0:
+                        result += std::string(subject) + "(" + object + std::to_string(prefix) + ").";
+                        break;
+                    case 1:
+                        result += std::string(subject) + "'" + object + ".";
+                        break;
+                    case 2:
+                        result += "tau.";
+                        break;
+                    case 3:
+                        result += "[" + std::string(subject) + "=" + object + "]";
+                        break;
+                }
+            }
+            result += "Agent" + std::to_string(random(1 << 16)) + "(a, b, chan)\n";
+        }
+        result += ";\n\n";
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::string generated;
+    std::optional<picalc::MappedFile> file;
+    std::string_view input;
+    if (argc > 1) {
+        auto mapped = picalc::MappedFile::open(argv[1]);
+        if (!mapped.has_value()) {
+            std::cerr << mapped.errors[0].message << "\n";
+            return 1;
+        }
+        file = std::move(*mapped);
+        input = file->contents();
+    } else {
+        generated = generate_model(size_t(128) << 20);
+        input = generated;
+    }
+
+    const int runs = 5;
+    double best = 0;
+    size_t token_count = 0;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        picalc::Arena arena;
+        picalc::SymbolTable symbols(arena);
+        auto tokens = picalc::tokenize(input, arena, symbols);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        if (!tokens.has_value()) {
+            std::cerr << tokens.errors[0].loc << ": " << tokens.errors[0].message << "\n";
+            return 1;
+        }
+        token_count = (*tokens).size();
+        best = std::max(best, input.size() / seconds.count() / (1 << 20));
+    }
+
+    std::cout << "input: " << input.size() / double(1 << 20) << " MB, "
+        << token_count << " tokens\n";
+    std::cout << "lexer: " << best << " MB/s (best of " << runs << " runs)\n";
+    return 0;
+}
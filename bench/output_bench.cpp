@@ -0,0 +1,142 @@
+// Compares the size of the generated mCRL2 and the time to generate it with
+// and without --compact.
+//
+// $ output_bench                      converts a generated model nested 4000 deep
+// $ output_bench <file.picalc>...     converts the given models
+
+#include "picalc/lexer.hpp"
+#include "picalc/mappedfile.hpp"
+#include "picalc/mcrl2converter.hpp"
+#include "picalc/nameanalysis.hpp"
+#include "picalc/outputsink.hpp"
+#include "picalc/parser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// A chain of prefixes under a sum, so that every level is indented once
+// more than the previous one in the pretty output.
+static std::string generate_deep_model(int depth) {
+    std::string result = "agent Main(a, b) =";
+    for (int level = 0; level < depth; level++) {
+        switch (level % 4) {
+            case 0:
+                result += " a(x).";
+                break;
+            case 1:
+                result += " x'b.";
+                break;
+            case 2:
+                result += " [a=b]";
+                break;
+            case 3:
+                result += " (b'a.0 + tau.";
+                break;
+        }
+    }
+    result += "0";
+    result += std::string(depth / 4, ')');
+    result += ";\n";
+    return result;
+}
+
+struct Measurement {
+    size_t size;
+    double milliseconds; // best of the runs
+};
+
+static bool measure(const std::string& name, std::string_view input) {
+    picalc::Arena arena;
+    picalc::SymbolTable symbols(arena);
+    auto tokens = picalc::tokenize(input, arena, symbols);
+    if (!tokens.has_value()) {
+        std::cerr << name << ": " << tokens.errors[0].loc << ": " << tokens.errors[0].message << "\n";
+        return false;
+    }
+    auto mod = picalc::parse_module(std::move(*tokens), std::move(symbols), arena);
+    if (!mod.has_value()) {
+        std::cerr << name << ": " << mod.errors[0].loc << ": " << mod.errors[0].message << "\n";
+        return false;
+    }
+    auto names_bound = picalc::compute_names_bound(*mod);
+    if (!names_bound.has_value()) {
+        std::cerr << name << ": " << names_bound.errors[0].loc << ": " << names_bound.errors[0].message << "\n";
+        return false;
+    }
+
+    const int runs = 5;
+    Measurement results[2];
+    for (bool compact : { false, true }) {
+        auto& result = results[compact];
+        result.milliseconds = 1e30;
+        for (int run = 0; run < runs; run++) {
+            auto output = picalc::OutputSink::open("/dev/null");
+            if (!output.has_value()) {
+                std::cerr << output.errors[0].message << "\n";
+                return false;
+            }
+            auto start = std::chrono::steady_clock::now();
+            auto size = picalc::convert_module_to_mcrl2(*mod, *names_bound, false, false, compact, *output);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (!size.has_value()) {
+                std::cerr << name << ": " << size.errors[0].loc << ": " << size.errors[0].message << "\n";
+                return false;
+            }
+            result.size = *size;
+            result.milliseconds = std::min(result.milliseconds, elapsed.count());
+        }
+    }
+
+    char line[256];
+    std::snprintf(
+        line,
+        sizeof(line),
+        "%-28s %12zu %12zu %7.1f%% %10.3f %10.3f",
+        name.c_str(),
+        results[0].size,
+        results[1].size,
+        100.0 * results[1].size / results[0].size,
+        results[0].milliseconds,
+        results[1].milliseconds
+    );
+    std::cout << line << "\n";
+    return true;
+}
+
+int main(int argc, char** argv) {
+    char header[256];
+    std::snprintf(
+        header,
+        sizeof(header),
+        "%-28s %12s %12s %8s %10s %10s",
+        "model",
+        "pretty (B)",
+        "compact (B)",
+        "ratio",
+        "pretty ms",
+        "compact ms"
+    );
+    std::cout << header << "\n";
+
+    if (argc == 1) {
+        return measure("deep (4000 levels)", generate_deep_model(4000)) ? 0 : 1;
+    }
+
+    int result = 0;
+    for (int i = 1; i < argc; i++) {
+        auto file = picalc::MappedFile::open(argv[i]);
+        if (!file.has_value()) {
+            std::cerr << file.errors[0].message << "\n";
+            return 1;
+        }
+        std::string name = argv[i];
+        name = name.substr(name.find_last_of('/') + 1);
+        if (!measure(name, (*file).contents())) {
+            result = 1;
+        }
+    }
+    return result;
+}
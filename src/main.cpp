@@ -1,20 +1,45 @@
 
 #include "picalc/cli.hpp"
+#include "picalc/cppconverter.hpp"
+#include "picalc/driver.hpp"
 #include "picalc/lexer.hpp"
+#include "picalc/mappedfile.hpp"
 #include "picalc/mcrl2converter.hpp"
+#include "picalc/nameanalysis.hpp"
+#include "picalc/outputsink.hpp"
 #include "picalc/parser.hpp"
+#include "picalc/processconverter.hpp"
 
-#include <fstream>
 #include <iostream>
-#include <sstream>
 
 const char* help_message = R"(pi2mcrl2 - a small tool for building mCRL2 models from pi-calculus expressions
 Usage:
 $ pi2mcrl2 <file.picalc> <args...>
 where <args...> is some of:
-    [--output <file>]       -o  Specifies the output .mcrl2 file
+    [--output <file>]       -o  Specifies the output .mcrl2 file (or .aut file with --explore)
     [--verbose]                 Prints extra information
     [--raw-output]              Do not give a full valid mCRL2 specification, only print the generated part
+    [--names <n>]               Use the names 0, ..., n - 1 for pi_names, instead of the computed bound
+    [--unique-names]            Give every binder its own name number, so that calls need no alpha-conversion
+    [--explore]                 Generate the state space natively and output it as an .aut file
+    [--congruence]              With --explore, identify states that are structurally congruent
+    [--alpha-canonical]         With --explore, identify states that are equal up to the names of binders
+    [--por]                     With --explore, only take an ample set of the transitions of independent
+                                parallel components, which preserves deadlocks and visible actions
+    [--counting]                With --explore, take the transitions of identical parallel components only once;
+                                implies --congruence, so that such components are kept next to each other
+    [--dump-bytecode]           Print the code that --explore runs for the body of every agent
+    [--nary]                    With the interpreter target, encode sums and parallel compositions as lists for
+                                ./mcrl2/picalc_nary.mcrl2, which takes the communications of all components at once
+                                (experimental: not yet compared with ./mcrl2/picalc.mcrl2 in mCRL2)
+    [--compact]                 Do not indent the generated mCRL2, and put every term of the interpreter target on
+                                a single line, so that deeply nested models do not produce quadratic output
+    [--threads <n>]             With --explore, generate the state space with n threads
+    [--cache-size <n>]          With --explore, cache the transitions of up to n subterms (default 65536, 0 disables)
+    [--target=<target>]         Either `interpreter` (default), which encodes the model as a term for the
+                                generic pi-calculus interpreter, `process`, which compiles every agent
+                                into its own mCRL2 process equation, or `cpp`, which compiles the model
+                                into a C++ program that generates its state space like --explore
 )";
 
 int main(int argc, char** argv) {
@@ -39,11 +64,20 @@ int main(int argc, char** argv) {
     }
     auto options = *expected_options;
 
-    std::ifstream file(options.input_file);
-    std::stringstream buffer;
-    buffer << file.rdbuf();
+    // the tokens and identifiers are views into the mapping
+    auto file = picalc::MappedFile::open(options.input_file);
+    if (!file.has_value()) {
+        for (auto& error : file.errors) {
+            std::cerr << error.loc << ": " << error.message << "\n";
+        }
+        return 1;
+    }
+    auto input = (*file).contents();
 
-    auto tokens = picalc::tokenize(buffer.str());
+    // owns the tokens, symbols and process nodes until the end of the run
+    picalc::Arena arena;
+    picalc::SymbolTable symbols(arena);
+    auto tokens = picalc::tokenize(input, arena, symbols);
     if (!tokens.has_value()) {
         for (auto& error : tokens.errors) {
             std::cerr << error.loc << ": " << error.message << "\n";
@@ -51,7 +85,7 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    auto mod = picalc::parse_module(std::move(*tokens));
+    auto mod = picalc::parse_module(std::move(*tokens), std::move(symbols), arena);
     if (!mod.has_value()) {
         for (auto& error : mod.errors) {
             std::cerr << error.loc << ": " << error.message << "\n";
@@ -61,34 +95,136 @@ int main(int argc, char** argv) {
 
     if (options.verbose) {
         std::cerr << "[verbose] module: " << *mod << "\n";
+        std::cerr << "[verbose] arena: " << arena.bytes_used() << " bytes used, "
+            << arena.bytes_reserved() << " bytes reserved\n";
+    }
+
+    int names_bound;
+    if (options.names.has_value()) {
+        names_bound = *options.names;
+    } else {
+        auto computed_bound = picalc::compute_names_bound(*mod);
+        if (!computed_bound.has_value()) {
+            for (auto& error : computed_bound.errors) {
+                std::cerr << error.loc << ": " << error.message << "\n";
+            }
+            return 1;
+        }
+        names_bound = *computed_bound;
+    }
+
+    if (options.verbose) {
+        std::cerr << "[verbose] names bound: " << names_bound << "\n";
+    }
+
+    if (options.explore || options.dump_bytecode) {
+        auto program = picalc::convert_module_to_agents(*mod, names_bound, options.unique_names);
+        if (!program.has_value()) {
+            for (auto& error : program.errors) {
+                std::cerr << error.loc << ": " << error.message << "\n";
+            }
+            return 1;
+        }
+
+        if (options.dump_bytecode) {
+            for (size_t i = 0; i < (*program).definitions.size(); i++) {
+                auto& def = (*program).definitions[i];
+                std::cout << "agent " << (*mod).declarations[i].id.value << "/" << def.arity << "\n";
+                picalc::print_bytecode(std::cout, def.code);
+            }
+            return 0;
+        }
+
+        return picalc::run_explorer(*program, options, names_bound);
     }
 
-    auto mcrl2 = picalc::convert_module_to_mcrl2(*mod);
-    if (!mcrl2.has_value()) {
-        for (auto& error : mcrl2.errors) {
+    if (options.target == picalc::Target::CPP) {
+        auto cpp = picalc::convert_module_to_cpp(*mod, input, names_bound, options.unique_names);
+        if (!cpp.has_value()) {
+            for (auto& error : cpp.errors) {
+                std::cerr << error.loc << ": " << error.message << "\n";
+            }
+            return 1;
+        }
+
+        auto output = options.output_file.has_value()
+            ? picalc::OutputSink::open(*options.output_file)
+            : picalc::OutputSink::standard_output();
+        if (!output.has_value()) {
+            for (auto& error : output.errors) {
+                std::cerr << error.loc << ": " << error.message << "\n";
+            }
+            return 1;
+        }
+        *output += *cpp;
+        auto written = (*output).commit();
+        if (!written.has_value()) {
+            for (auto& error : written.errors) {
+                std::cerr << error.loc << ": " << error.message << "\n";
+            }
+            return 1;
+        }
+        return 0;
+    }
+
+    auto output = options.output_file.has_value()
+        ? picalc::OutputSink::open(*options.output_file)
+        : picalc::OutputSink::standard_output();
+    if (!output.has_value()) {
+        for (auto& error : output.errors) {
             std::cerr << error.loc << ": " << error.message << "\n";
         }
         return 1;
     }
 
-    std::string output;
-    if (options.raw_output) {
-        output = std::move(*mcrl2);
-    } else {
-        std::ifstream mcrl2_def_file("./mcrl2/picalc.mcrl2");
-        std::stringstream buffer;
-        buffer << mcrl2_def_file.rdbuf();
-        output = buffer.str();
-        output += "init PiInterpreter(\n% BEGIN GENERATED\n";
-        output += *mcrl2;
-        output += "\n% END GENERATED\n);";
-    }
-
-    if (options.output_file.has_value()) {
-        std::ofstream output_file(*options.output_file);
-        output_file << output;
+    if (!options.raw_output) {
+        // copied straight from the mapping into the output
+        auto mcrl2_def_file = picalc::MappedFile::open(
+            options.target == picalc::Target::PROCESS ? "./mcrl2/picalc_process.mcrl2"
+                : options.nary ? "./mcrl2/picalc_nary.mcrl2"
+                : "./mcrl2/picalc.mcrl2"
+        );
+        if (mcrl2_def_file.has_value()) {
+            *output += (*mcrl2_def_file).contents();
+        }
+        *output += "% BEGIN GENERATED\n";
+    }
+
+    std::vector<picalc::Error> errors;
+    if (options.target == picalc::Target::PROCESS) {
+        auto mcrl2 = picalc::convert_module_to_mcrl2_processes(*mod, names_bound, options.compact);
+        if (mcrl2.has_value()) {
+            *output += *mcrl2;
+        }
+        errors = std::move(mcrl2.errors);
     } else {
-        std::cout << output;
+        auto size = picalc::convert_module_to_mcrl2(
+            *mod,
+            names_bound,
+            options.unique_names,
+            options.nary,
+            options.compact,
+            *output
+        );
+        errors = std::move(size.errors);
+    }
+    if (!errors.empty()) {
+        for (auto& error : errors) {
+            std::cerr << error.loc << ": " << error.message << "\n";
+        }
+        return 1;
+    }
+
+    if (!options.raw_output) {
+        *output += "% END GENERATED\n";
+    }
+
+    auto written = (*output).commit();
+    if (!written.has_value()) {
+        for (auto& error : written.errors) {
+            std::cerr << error.loc << ": " << error.message << "\n";
+        }
+        return 1;
     }
 
     return 0;
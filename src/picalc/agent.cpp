@@ -0,0 +1,690 @@
+#include "agent.hpp"
+
+#include <algorithm>
+
+namespace picalc {
+
+static size_t combine_hash(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+static AgentPtr make_agent(
+    AgentKind kind,
+    PiName name1,
+    PiName name2,
+    PiIdentifier id,
+    std::vector<PiName> args,
+    AgentPtr lhs,
+    AgentPtr rhs
+) {
+    size_t hash = static_cast<size_t>(kind);
+    hash = combine_hash(hash, name1);
+    hash = combine_hash(hash, name2);
+    hash = combine_hash(hash, id);
+    for (auto arg : args) {
+        hash = combine_hash(hash, arg);
+    }
+    hash = combine_hash(hash, lhs ? lhs->hash : 0);
+    hash = combine_hash(hash, rhs ? rhs->hash : 0);
+
+    // generic_names for a single node
+    NameBits free_name_bits;
+    switch (kind) {
+        case AgentKind::ZERO:
+            break;
+        case AgentKind::SUMMATION:
+        case AgentKind::PARALLEL_COMPOSITION:
+            free_name_bits = lhs->free_name_bits;
+            free_name_bits.insert_all(rhs->free_name_bits);
+            break;
+        case AgentKind::INPUT_PREFIX:
+            free_name_bits = lhs->free_name_bits;
+            free_name_bits.erase(name2);
+            free_name_bits.insert(name1);
+            break;
+        case AgentKind::OUTPUT_PREFIX:
+        case AgentKind::MATCH:
+            free_name_bits = lhs->free_name_bits;
+            free_name_bits.insert(name1);
+            free_name_bits.insert(name2);
+            break;
+        case AgentKind::TAU_PREFIX:
+            free_name_bits = lhs->free_name_bits;
+            break;
+        case AgentKind::RESTRICTION:
+            free_name_bits = lhs->free_name_bits;
+            free_name_bits.erase(name1);
+            break;
+        case AgentKind::IDENTIFIER:
+            for (auto arg : args) {
+                free_name_bits.insert(arg);
+            }
+            break;
+    }
+
+    return term_store().intern(Agent {
+        kind,
+        name1,
+        name2,
+        id,
+        std::move(args),
+        lhs,
+        rhs,
+        hash,
+        free_name_bits
+    });
+}
+
+AgentPtr make_zero() {
+    static const AgentPtr zero = make_agent(AgentKind::ZERO, 0, 0, 0, {}, nullptr, nullptr);
+    return zero;
+}
+
+AgentPtr make_summation(AgentPtr lhs, AgentPtr rhs) {
+    return make_agent(AgentKind::SUMMATION, 0, 0, 0, {}, std::move(lhs), std::move(rhs));
+}
+
+AgentPtr make_input_prefix(PiName channel, PiName data, AgentPtr suffix) {
+    return make_agent(AgentKind::INPUT_PREFIX, channel, data, 0, {}, std::move(suffix), nullptr);
+}
+
+AgentPtr make_output_prefix(PiName channel, PiName data, AgentPtr suffix) {
+    return make_agent(AgentKind::OUTPUT_PREFIX, channel, data, 0, {}, std::move(suffix), nullptr);
+}
+
+AgentPtr make_tau_prefix(AgentPtr suffix) {
+    return make_agent(AgentKind::TAU_PREFIX, 0, 0, 0, {}, std::move(suffix), nullptr);
+}
+
+AgentPtr make_parallel_composition(AgentPtr lhs, AgentPtr rhs) {
+    return make_agent(AgentKind::PARALLEL_COMPOSITION, 0, 0, 0, {}, std::move(lhs), std::move(rhs));
+}
+
+AgentPtr make_restriction(PiName name, AgentPtr suffix) {
+    return make_agent(AgentKind::RESTRICTION, name, 0, 0, {}, std::move(suffix), nullptr);
+}
+
+AgentPtr make_match(PiName name1, PiName name2, AgentPtr suffix) {
+    return make_agent(AgentKind::MATCH, name1, name2, 0, {}, std::move(suffix), nullptr);
+}
+
+AgentPtr make_identifier(PiIdentifier id, std::vector<PiName> args) {
+    return make_agent(AgentKind::IDENTIFIER, 0, 0, id, std::move(args), nullptr, nullptr);
+}
+
+bool operator==(const Agent& lhs, const Agent& rhs) {
+    return lhs.hash == rhs.hash &&
+        lhs.kind == rhs.kind &&
+        lhs.name1 == rhs.name1 &&
+        lhs.name2 == rhs.name2 &&
+        lhs.id == rhs.id &&
+        lhs.args == rhs.args &&
+        lhs.lhs == rhs.lhs &&
+        lhs.rhs == rhs.rhs;
+}
+
+TermStore::TermStore()
+    : chunks(new std::atomic<Agent*>[NUM_CHUNKS]),
+      shards(new Shard[NUM_SHARDS]) {
+    for (size_t i = 0; i < NUM_CHUNKS; i++) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+TermStore::~TermStore() {
+    for (size_t i = 0; i < NUM_CHUNKS; i++) {
+        delete[] chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+AgentPtr TermStore::intern(Agent agent) {
+    auto& shard = shards[agent.hash % NUM_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto range = shard.nodes.equal_range(agent.hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if ((*this)[it->second] == agent) {
+            return AgentPtr(it->second);
+        }
+    }
+
+    uint32_t index = counter.fetch_add(1);
+    auto& chunk = chunks[index >> CHUNK_BITS];
+    if (chunk.load(std::memory_order_acquire) == nullptr) {
+        std::lock_guard<std::mutex> chunk_lock(chunk_mutex);
+        if (chunk.load(std::memory_order_relaxed) == nullptr) {
+            chunk.store(new Agent[size_t(1) << CHUNK_BITS], std::memory_order_release);
+        }
+    }
+    // other threads only learn the index through this shard or through nodes
+    // that are added later, so the node is complete before it is read
+    chunk.load(std::memory_order_acquire)[index & CHUNK_MASK] = std::move(agent);
+    shard.nodes.emplace((*this)[index].hash, index);
+    return AgentPtr(index);
+}
+
+TermStore& term_store() {
+    static TermStore store;
+    return store;
+}
+
+// generic_names in the specification; `free_only` selects free_names over
+// names, which does not need `bound`. The binders extend `bound` in place and
+// restore it.
+static void generic_names(
+    const Agent& agent,
+    NameSet& bound,
+    bool free_only,
+    NameSet& result
+) {
+    auto add = [&](PiName name) {
+        if (!free_only || bound.find(name) == bound.end()) {
+            result.insert(name);
+        }
+    };
+
+    auto add_bound = [&](PiName name, const Agent& suffix) {
+        bool inserted = free_only && bound.insert(name).second;
+        generic_names(suffix, bound, free_only, result);
+        if (inserted) {
+            bound.erase(name);
+        }
+    };
+
+    switch (agent.kind) {
+        case AgentKind::ZERO:
+            break;
+        case AgentKind::SUMMATION:
+        case AgentKind::PARALLEL_COMPOSITION:
+            generic_names(*agent.lhs, bound, free_only, result);
+            generic_names(*agent.rhs, bound, free_only, result);
+            break;
+        case AgentKind::INPUT_PREFIX:
+            add(agent.name1);
+            add_bound(agent.name2, *agent.lhs);
+            break;
+        case AgentKind::OUTPUT_PREFIX:
+        case AgentKind::MATCH:
+            add(agent.name1);
+            add(agent.name2);
+            generic_names(*agent.lhs, bound, free_only, result);
+            break;
+        case AgentKind::TAU_PREFIX:
+            generic_names(*agent.lhs, bound, free_only, result);
+            break;
+        case AgentKind::RESTRICTION:
+            add_bound(agent.name1, *agent.lhs);
+            break;
+        case AgentKind::IDENTIFIER:
+            for (auto arg : agent.args) {
+                add(arg);
+            }
+            break;
+    }
+}
+
+NameSet free_names(const Agent& agent) {
+    NameSet bound;
+    NameSet result;
+    generic_names(agent, bound, true, result);
+    return result;
+}
+
+NameSet names(const Agent& agent) {
+    NameSet bound;
+    NameSet result;
+    generic_names(agent, bound, false, result);
+    return result;
+}
+
+bool is_free_name(const Agent& agent, PiName name) {
+    if (name < NameBits::CAPACITY || !agent.free_name_bits.overflow) {
+        return agent.free_name_bits.contains(name);
+    }
+    auto free = free_names(agent);
+    return free.find(name) != free.end();
+}
+
+PiName get_unused_name(const NameSet& set, PiName start) {
+    while (set.find(start) != set.end()) {
+        start++;
+    }
+    return start;
+}
+
+static PiName substitute_name(const Substitution& sigma, PiName name) {
+    auto it = sigma.find(name);
+    return it == sigma.end() ? name : it->second;
+}
+
+BinderChange push_binder(PiName bound_name, PiName name, Substitution& sigma, NameSet& range) {
+    BinderChange change { bound_name, name, std::nullopt };
+    auto it = sigma.find(bound_name);
+    if (it != sigma.end()) {
+        change.shadowed = it->second;
+        sigma.erase(it);
+    }
+    if (name != bound_name) {
+        sigma[bound_name] = name;
+        range.insert(name);
+    }
+    return change;
+}
+
+void pop_binder(const BinderChange& change, Substitution& sigma, NameSet& range) {
+    if (change.name != change.bound_name) {
+        sigma.erase(change.bound_name);
+        range.erase(change.name);
+    }
+    if (change.shadowed.has_value()) {
+        sigma[change.bound_name] = *change.shadowed;
+    }
+}
+
+// shared by input prefixes and restrictions, because they both bind a name
+static std::pair<PiName, AgentPtr> substitute_binder(
+    PiName bound_name,
+    const AgentPtr& suffix,
+    Substitution& sigma,
+    NameSet& range
+) {
+    PiName name = bound_name;
+    if (range.find(bound_name) != range.end()) {
+        // alpha conversion: the bound name would capture a name in the range
+        NameSet used = names(*suffix);
+        used.insert(range.begin(), range.end());
+        name = get_unused_name(used, 0);
+    }
+
+    auto change = push_binder(bound_name, name, sigma, range);
+    auto result = substitute_rec(suffix, sigma, range);
+    pop_binder(change, sigma, range);
+    return { name, result };
+}
+
+AgentPtr substitute_rec(const AgentPtr& agent, Substitution& sigma, NameSet& range) {
+    switch (agent->kind) {
+        case AgentKind::ZERO:
+            return agent;
+        case AgentKind::SUMMATION:
+            return make_summation(
+                substitute_rec(agent->lhs, sigma, range),
+                substitute_rec(agent->rhs, sigma, range)
+            );
+        case AgentKind::INPUT_PREFIX: {
+            auto [data, suffix] = substitute_binder(agent->name2, agent->lhs, sigma, range);
+            return make_input_prefix(substitute_name(sigma, agent->name1), data, std::move(suffix));
+        }
+        case AgentKind::OUTPUT_PREFIX:
+            return make_output_prefix(
+                substitute_name(sigma, agent->name1),
+                substitute_name(sigma, agent->name2),
+                substitute_rec(agent->lhs, sigma, range)
+            );
+        case AgentKind::TAU_PREFIX:
+            return make_tau_prefix(substitute_rec(agent->lhs, sigma, range));
+        case AgentKind::PARALLEL_COMPOSITION:
+            return make_parallel_composition(
+                substitute_rec(agent->lhs, sigma, range),
+                substitute_rec(agent->rhs, sigma, range)
+            );
+        case AgentKind::RESTRICTION: {
+            auto [name, suffix] = substitute_binder(agent->name1, agent->lhs, sigma, range);
+            return make_restriction(name, std::move(suffix));
+        }
+        case AgentKind::MATCH:
+            return make_match(
+                substitute_name(sigma, agent->name1),
+                substitute_name(sigma, agent->name2),
+                substitute_rec(agent->lhs, sigma, range)
+            );
+        case AgentKind::IDENTIFIER: {
+            std::vector<PiName> args;
+            args.reserve(agent->args.size());
+            for (auto arg : agent->args) {
+                args.push_back(substitute_name(sigma, arg));
+            }
+            return make_identifier(agent->id, std::move(args));
+        }
+    }
+    assert(false && "unknown agent kind");
+    return agent;
+}
+
+AgentPtr substitute_single(const AgentPtr& agent, PiName old_name, PiName new_name) {
+    Substitution sigma { { old_name, new_name } };
+    NameSet range { old_name, new_name };
+    return substitute_rec(agent, sigma, range);
+}
+
+struct AgentConverterState {
+    std::vector<Error> errors;
+    std::vector<std::vector<PiName>> name_map; // per symbol: the numbers of the enclosing binders
+    std::vector<std::optional<PiIdentifier>> variable_map; // per symbol: the index of its declaration
+    PiName name_counter;
+    bool unique_names;
+};
+
+static std::optional<PiName> get_bound_name(
+    const Identifier& id,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    auto& scopes = state.name_map[id.symbol];
+    if (scopes.empty()) {
+        state.errors.push_back(Error {
+            ErrorType::IDENTIFIER,
+            loc,
+            "Unbound name `" + std::string(id.value) + "`"
+        });
+        return std::nullopt;
+    }
+    return scopes.back();
+}
+
+// returns the new name number
+static PiName add_bound_name(const Identifier& id, AgentConverterState& state) {
+    PiName new_value = state.name_counter++;
+    state.name_map[id.symbol].push_back(new_value);
+    return new_value;
+}
+
+static void remove_bound_name(const Identifier& id, AgentConverterState& state) {
+    state.name_map[id.symbol].pop_back();
+    if (!state.unique_names) {
+        state.name_counter--;
+    }
+}
+
+static AgentPtr convert_proc_to_agent(const Module& mod, ProcIndex proc, AgentConverterState& state);
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const ZeroProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    return make_zero();
+}
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const TauPrefixProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    return make_tau_prefix(convert_proc_to_agent(mod, proc.proc, state));
+}
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const PositivePrefixProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    auto subject_name = get_bound_name(proc.subject, loc, state);
+    if (!subject_name) return make_zero();
+
+    auto object_name = add_bound_name(proc.object, state);
+    auto suffix = convert_proc_to_agent(mod, proc.proc, state);
+    remove_bound_name(proc.object, state);
+
+    return make_input_prefix(*subject_name, object_name, std::move(suffix));
+}
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const NegativePrefixProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    auto subject_name = get_bound_name(proc.subject, loc, state);
+    auto object_name = get_bound_name(proc.object, loc, state);
+    if (!subject_name || !object_name) return make_zero();
+
+    return make_output_prefix(
+        *subject_name,
+        *object_name,
+        convert_proc_to_agent(mod, proc.proc, state)
+    );
+}
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const MatchProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    auto matched_name1 = get_bound_name(proc.name1, loc, state);
+    auto matched_name2 = get_bound_name(proc.name2, loc, state);
+    if (!matched_name1 || !matched_name2) return make_zero();
+
+    return make_match(
+        *matched_name1,
+        *matched_name2,
+        convert_proc_to_agent(mod, proc.proc, state)
+    );
+}
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const RestrictionProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    auto restricted_name = add_bound_name(proc.name, state);
+    auto suffix = convert_proc_to_agent(mod, proc.proc, state);
+    remove_bound_name(proc.name, state);
+
+    return make_restriction(restricted_name, std::move(suffix));
+}
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const SumProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    auto result = convert_proc_to_agent(mod, proc.operands[0], state);
+    for (size_t i = 1; i < proc.operands.size(); i++) {
+        auto rhs = convert_proc_to_agent(mod, proc.operands[i], state);
+        result = make_summation(std::move(result), std::move(rhs));
+    }
+    return result;
+}
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const ParallelProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    auto result = convert_proc_to_agent(mod, proc.operands[0], state);
+    for (size_t i = 1; i < proc.operands.size(); i++) {
+        auto rhs = convert_proc_to_agent(mod, proc.operands[i], state);
+        result = make_parallel_composition(std::move(result), std::move(rhs));
+    }
+    return result;
+}
+
+static AgentPtr convert_proc_to_agent(
+    const Module& mod,
+    const IdentifierProc& proc,
+    SourceLocation loc,
+    AgentConverterState& state
+) {
+    auto var = state.variable_map[proc.variable_id.symbol];
+    if (!var.has_value()) {
+        state.errors.push_back(Error(
+            ErrorType::IDENTIFIER,
+            loc,
+            "Unknown recursion variable `" + std::string(proc.variable_id.value) + "`"
+        ));
+        return make_zero();
+    }
+
+    // the explorer binds the parameters to the arguments by position
+    auto& decl = mod.declarations[*var];
+    if (decl.params.size() != proc.args.size()) {
+        state.errors.push_back(Error(
+            ErrorType::IDENTIFIER,
+            loc,
+            "Agent `" + std::string(proc.variable_id.value) + "` expects " +
+                std::to_string(decl.params.size()) + " arguments"
+        ));
+        return make_zero();
+    }
+
+    std::vector<PiName> args;
+    for (auto arg : proc.args) {
+        auto name = get_bound_name(arg, loc, state);
+        if (!name) continue;
+        args.push_back(*name);
+    }
+    return make_identifier(*var, std::move(args));
+}
+
+static AgentPtr convert_proc_to_agent(const Module& mod, ProcIndex proc, AgentConverterState& state) {
+    auto loc = mod.get_loc(proc);
+    return mod.visit<AgentPtr>(proc, [&](auto& arg) {
+        return convert_proc_to_agent(mod, arg, loc, state);
+    });
+}
+
+static PiDefinition convert_decl_to_agent(
+    const Module& mod,
+    const ProcDecl& decl,
+    AgentConverterState& state
+) {
+    PiName next_binder = state.name_counter;
+    state.name_counter = 0;
+    for (auto& id : decl.params) {
+        add_bound_name(id, state);
+    }
+    if (state.unique_names) {
+        state.name_counter = next_binder;
+    }
+
+    auto agent = convert_proc_to_agent(mod, decl.proc, state);
+
+    for (int i = decl.params.size() - 1; i >= 0; i--) {
+        remove_bound_name(decl.params[i], state);
+    }
+
+    return PiDefinition { decl.params.size(), std::move(agent) };
+}
+
+// The depth of every node in its agent, where the operands of a sum or parallel
+// composition are nested to the left, so that the first operand is one level
+// deeper per further operand. The loop visits the children of a node before it.
+std::vector<size_t> get_agent_depths(const Module& mod) {
+    std::vector<size_t> depths(mod.kinds.size());
+    for (ProcIndex proc = 0; proc < mod.kinds.size(); proc++) {
+        switch (mod.kinds[proc]) {
+            case ProcKind::ZERO:
+            case ProcKind::IDENTIFIER:
+                depths[proc] = 1;
+                break;
+            case ProcKind::TAU_PREFIX:
+            case ProcKind::POSITIVE_PREFIX:
+            case ProcKind::NEGATIVE_PREFIX:
+            case ProcKind::MATCH:
+            case ProcKind::RESTRICTION:
+                depths[proc] = depths[mod.suffixes[proc]] + 1;
+                break;
+            case ProcKind::SUM:
+            case ProcKind::PARALLEL: {
+                auto operands = mod.get_operands(proc);
+                size_t depth = depths[operands[0]];
+                for (size_t i = 1; i < operands.size(); i++) {
+                    depth = std::max(depth, depths[operands[i]]) + 1;
+                }
+                depths[proc] = depth;
+                break;
+            }
+        }
+    }
+
+    std::vector<size_t> result;
+    for (auto& decl : mod.declarations) {
+        result.push_back(depths[decl.proc]);
+    }
+    return result;
+}
+
+Expected<PiProgram> convert_module_to_agents(const Module& mod, PiName names_bound, bool unique_names) {
+    AgentConverterState state {};
+    state.name_map.resize(mod.symbols.size());
+    state.variable_map.resize(mod.symbols.size());
+    state.unique_names = unique_names;
+    std::optional<PiIdentifier> main_index;
+
+    for (PiIdentifier i = 0; i < mod.declarations.size(); i++) {
+        auto& decl = mod.declarations[i];
+        auto& var = state.variable_map[decl.id.symbol];
+        if (var.has_value()) {
+            state.errors.push_back(Error {
+                ErrorType::IDENTIFIER,
+                decl.loc,
+                "Duplicate process variable name"
+            });
+        }
+        var = i;
+
+        if (decl.id.value == "Main") {
+            main_index = i;
+        }
+    }
+
+    if (!main_index.has_value()) {
+        state.errors.push_back(Error {
+            ErrorType::IDENTIFIER,
+            SourceLocation(0, 0),
+            "No starting process found; it should be called `Main`"
+        });
+    }
+
+    // the conversion and the explorer are recursive
+    auto depths = get_agent_depths(mod);
+    for (size_t i = 0; i < mod.declarations.size(); i++) {
+        if (depths[i] > max_agent_depth) {
+            state.errors.push_back(Error(
+                ErrorType::UNSUPPORTED,
+                mod.declarations[i].loc,
+                "Agent `" + std::string(mod.declarations[i].id.value) + "` is nested more than " +
+                    std::to_string(max_agent_depth) + " deep"
+            ));
+        }
+    }
+
+    if (state.errors.size() > 0) {
+        return Expected<PiProgram>(std::move(state.errors));
+    }
+
+    if (unique_names) {
+        state.name_counter = names_bound;
+        for (auto& decl : mod.declarations) {
+            state.name_counter = std::max(state.name_counter, static_cast<PiName>(decl.params.size()));
+        }
+    }
+
+    PiProgram program;
+    for (auto& decl : mod.declarations) {
+        program.definitions.push_back(convert_decl_to_agent(mod, decl, state));
+        program.definitions.back().code = compile_bytecode(program.definitions.back().agent);
+    }
+
+    std::vector<PiName> main_args;
+    for (PiName i = 0; i < mod.declarations[*main_index].params.size(); i++) {
+        main_args.push_back(i);
+    }
+    program.initial_agent = make_identifier(*main_index, std::move(main_args));
+
+    if (state.errors.size() > 0) {
+        return Expected<PiProgram>(std::move(state.errors));
+    }
+
+    return program;
+}
+
+} // end namespace picalc
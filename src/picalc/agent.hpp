@@ -0,0 +1,242 @@
+#ifndef PICALC_AGENT_H
+#define PICALC_AGENT_H
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "core.hpp"
+#include "namebits.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace picalc {
+
+// Native counterparts of the sorts in mcrl2/picalc.mcrl2. The functions on
+// agents follow the equations of that specification one-to-one, so that the
+// native explorer generates the same states as `PiInterpreter` does.
+
+using PiName = uint32_t;
+
+using PiIdentifier = uint32_t;
+
+using NameSet = std::set<PiName>;
+
+// maps every name that is not in the map to itself
+using Substitution = std::unordered_map<PiName, PiName>;
+
+enum class AgentKind {
+    ZERO,
+    SUMMATION,
+    INPUT_PREFIX,
+    OUTPUT_PREFIX,
+    TAU_PREFIX,
+    PARALLEL_COMPOSITION,
+    RESTRICTION,
+    MATCH,
+    IDENTIFIER
+};
+
+struct Agent;
+
+// An agent in the term store. Equal agents are stored only once, so two
+// agents are equal exactly when their indices are, and successor states share
+// all of their unchanged subterms.
+class AgentPtr final {
+public:
+    AgentPtr() = default;
+
+    AgentPtr(std::nullptr_t) {}
+
+    explicit AgentPtr(uint32_t index) : index(index) {}
+
+    uint32_t get_index() const {
+        return index;
+    }
+
+    const Agent& operator*() const;
+
+    const Agent* operator->() const;
+
+    explicit operator bool() const {
+        return index != NONE;
+    }
+
+    bool operator==(const AgentPtr& rhs) const {
+        return index == rhs.index;
+    }
+
+    bool operator!=(const AgentPtr& rhs) const {
+        return index != rhs.index;
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    uint32_t index = NONE;
+};
+
+// agents are immutable, so successor states can share subterms
+struct Agent final {
+    AgentKind kind;
+    PiName name1; // channel, restricted name or first matched name
+    PiName name2; // data or second matched name
+    PiIdentifier id;
+    std::vector<PiName> args;
+    AgentPtr lhs; // also the suffix of prefixes, restrictions and matches
+    AgentPtr rhs;
+    size_t hash; // structural, so it does not depend on the order of interning
+    NameBits free_name_bits; // free_names, computed from the children
+};
+
+// compares the fields of two nodes; the children are compared by index
+bool operator==(const Agent& lhs, const Agent& rhs);
+
+// The unique table of all agents. Nodes are stored in chunks that are never
+// moved or freed, so that they can be read without locking while other
+// threads add nodes; the table itself is sharded, with a lock per shard.
+class TermStore final {
+public:
+    TermStore();
+
+    ~TermStore();
+
+    TermStore(const TermStore&) = delete;
+
+    TermStore& operator=(const TermStore&) = delete;
+
+    // returns the stored agent equal to the given one, adding it if needed
+    AgentPtr intern(Agent agent);
+
+    const Agent& operator[](uint32_t index) const {
+        return chunks[index >> CHUNK_BITS].load(std::memory_order_acquire)[index & CHUNK_MASK];
+    }
+
+    // the number of distinct nodes
+    size_t size() const {
+        return counter.load();
+    }
+
+private:
+    static constexpr uint32_t CHUNK_BITS = 16;
+    static constexpr uint32_t CHUNK_MASK = (1u << CHUNK_BITS) - 1;
+    static constexpr size_t NUM_CHUNKS = size_t(1) << (32 - CHUNK_BITS);
+    static constexpr size_t NUM_SHARDS = 256;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_multimap<size_t, uint32_t> nodes; // hash to index
+    };
+
+    std::unique_ptr<std::atomic<Agent*>[]> chunks;
+    std::mutex chunk_mutex;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<uint32_t> counter { 0 };
+};
+
+// the store of all agents in the program
+TermStore& term_store();
+
+inline const Agent& AgentPtr::operator*() const {
+    return term_store()[index];
+}
+
+inline const Agent* AgentPtr::operator->() const {
+    return &term_store()[index];
+}
+
+AgentPtr make_zero();
+
+AgentPtr make_summation(AgentPtr lhs, AgentPtr rhs);
+
+AgentPtr make_input_prefix(PiName channel, PiName data, AgentPtr suffix);
+
+AgentPtr make_output_prefix(PiName channel, PiName data, AgentPtr suffix);
+
+AgentPtr make_tau_prefix(AgentPtr suffix);
+
+AgentPtr make_parallel_composition(AgentPtr lhs, AgentPtr rhs);
+
+AgentPtr make_restriction(PiName name, AgentPtr suffix);
+
+AgentPtr make_match(PiName name1, PiName name2, AgentPtr suffix);
+
+AgentPtr make_identifier(PiIdentifier id, std::vector<PiName> args);
+
+struct AgentPtrHash {
+    size_t operator()(const AgentPtr& agent) const {
+        return std::hash<uint32_t>()(agent.get_index());
+    }
+};
+
+struct AgentPtrEqual {
+    bool operator()(const AgentPtr& lhs, const AgentPtr& rhs) const {
+        return lhs == rhs;
+    }
+};
+
+NameSet free_names(const Agent& agent);
+
+NameSet names(const Agent& agent);
+
+// `name in free_names(agent)`, without a traversal unless the agent has free
+// names from NameBits::CAPACITY onwards
+bool is_free_name(const Agent& agent, PiName name);
+
+PiName get_unused_name(const NameSet& set, PiName start);
+
+// What push_binder changed in a substitution and its range, for pop_binder.
+struct BinderChange final {
+    PiName bound_name;
+    PiName name; // the name of the binder in the result
+    std::optional<PiName> shadowed; // the entry of sigma for the bound name
+};
+
+// Extends sigma and range in place for the suffix of a binder of
+// `bound_name`, which becomes `name`: either the bound name itself, which
+// shadows its entry in sigma, or an unused name if the bound name is in the
+// range (alpha conversion).
+BinderChange push_binder(PiName bound_name, PiName name, Substitution& sigma, NameSet& range);
+
+// undoes the matching push_binder
+void pop_binder(const BinderChange& change, Substitution& sigma, NameSet& range);
+
+// sigma and range are extended at the binders of the agent, and are the same
+// again on return
+AgentPtr substitute_rec(const AgentPtr& agent, Substitution& sigma, NameSet& range);
+
+AgentPtr substitute_single(const AgentPtr& agent, PiName old_name, PiName new_name);
+
+struct PiDefinition {
+    size_t arity; // for params, use [0, ..., arity - 1]
+    AgentPtr agent;
+    Bytecode code; // of the agent, for the IDE rule of the explorer
+};
+
+struct PiProgram {
+    std::vector<PiDefinition> definitions;
+    AgentPtr initial_agent;
+};
+
+// The explorer and the C++ target work recursively on agents, so their depth
+// is limited to stay well within the call stack, also with the larger frames
+// of a build with AddressSanitizer.
+constexpr size_t max_agent_depth = 2000;
+
+// the nesting depth of the agent of every declaration, in the order of the
+// declarations; computed without recursion, so it can guard the recursive passes
+std::vector<size_t> get_agent_depths(const Module& mod);
+
+// numbers names exactly like convert_module_to_mcrl2 does; fails for agents
+// nested more than max_agent_depth deep
+Expected<PiProgram> convert_module_to_agents(const Module& mod, PiName names_bound, bool unique_names);
+
+} // end namespace picalc
+
+#endif
@@ -0,0 +1,40 @@
+#include "arena.hpp"
+
+namespace picalc {
+
+void* Arena::allocate_slow(size_t size, size_t alignment) {
+    size_t size_with_padding = size + alignment - 1;
+
+    // a large allocation gets a block of its own, so that the rest of the
+    // current block is not lost
+    if (size > large_size()) {
+        std::unique_ptr<char[]> block(new char[size_with_padding]); // not zeroed
+        auto address = reinterpret_cast<uintptr_t>(block.get());
+        void* pointer = block.get() + (-address & (alignment - 1));
+        large_blocks.push_back(LargeBlock { std::move(block), pointer, size_with_padding });
+        reserved += size_with_padding;
+        used += size;
+        return pointer;
+    }
+
+    blocks.push_back(std::unique_ptr<char[]>(new char[block_size]));
+    reserved += block_size;
+    next = blocks.back().get();
+    remaining = block_size;
+    return allocate(size, alignment);
+}
+
+void Arena::deallocate_large(void* pointer, size_t size) {
+    // there are only a few, and a vector frees its buffer right after it
+    // allocated the next one
+    for (size_t i = large_blocks.size(); i-- > 0;) {
+        if (large_blocks[i].pointer == pointer) {
+            reserved -= large_blocks[i].size;
+            used -= size;
+            large_blocks.erase(large_blocks.begin() + i);
+            return;
+        }
+    }
+}
+
+} // end namespace picalc
@@ -0,0 +1,118 @@
+#ifndef PICALC_ARENA_H
+#define PICALC_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace picalc {
+
+// A monotonic bump allocator that owns the tokens, symbols and process
+// nodes of one compilation. Allocations are carved out of large blocks and
+// are never freed one by one; everything is released at once when the arena
+// is destroyed. Only allocations too large to share a block, such as the
+// buffers of the token and node arrays, get a block of their own, which is
+// released when the array grows out of it.
+class Arena final {
+public:
+    explicit Arena(size_t block_size = size_t(1) << 20) : block_size(block_size) {}
+
+    Arena(const Arena&) = delete;
+
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment) {
+        size_t padding = -reinterpret_cast<uintptr_t>(next) & (alignment - 1);
+        if (padding + size > remaining) {
+            return allocate_slow(size, alignment);
+        }
+        char* result = next + padding;
+        next = result + size;
+        remaining -= padding + size;
+        used += size;
+        return result;
+    }
+
+    void deallocate(void* pointer, size_t size) {
+        if (size > large_size()) {
+            deallocate_large(pointer, size);
+        }
+    }
+
+    // the bytes handed out and not released
+    size_t bytes_used() const {
+        return used;
+    }
+
+    // the bytes of all blocks
+    size_t bytes_reserved() const {
+        return reserved;
+    }
+
+private:
+    struct LargeBlock {
+        std::unique_ptr<char[]> block;
+        void* pointer; // aligned
+        size_t size; // of the block
+    };
+
+    size_t large_size() const {
+        return block_size / 4;
+    }
+
+    void* allocate_slow(size_t size, size_t alignment);
+
+    void deallocate_large(void* pointer, size_t size);
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<LargeBlock> large_blocks;
+    char* next = nullptr;
+    size_t remaining = 0;
+    size_t block_size;
+    size_t used = 0;
+    size_t reserved = 0;
+};
+
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator(Arena& arena) : arena(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& rhs) : arena(rhs.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t n) {
+        arena->deallocate(pointer, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& rhs) const {
+        return arena == rhs.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& rhs) const {
+        return arena != rhs.arena;
+    }
+
+    Arena* arena;
+};
+
+// a vector in the arena; the buffers it grows out of stay in the arena until
+// the end, unless they were large
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // end namespace picalc
+
+#endif
@@ -2,39 +2,64 @@
 
 namespace picalc {
 
-std::ostream& operator<<(std::ostream& os, ZeroProc const& proc) {
-    return os << "0";
+// A process still to print, or the text after the processes above it on the
+// stack. Printing keeps them on an explicit stack instead of the call stack,
+// so that the depth of a process is only limited by memory.
+struct PrintTask final {
+    ProcIndex proc;
+    const char* text; // printed instead of `proc` unless it is null
+};
+
+using PrintTasks = std::vector<PrintTask>;
+
+static void print_proc(std::ostream& os, const ZeroProc& proc, PrintTasks& tasks) {
+    os << "0";
 }
 
-std::ostream& operator<<(std::ostream& os, TauPrefixProc const& proc) {
-    return os << "tau . " << *proc.proc;
+static void print_proc(std::ostream& os, const TauPrefixProc& proc, PrintTasks& tasks) {
+    os << "tau . ";
+    tasks.push_back(PrintTask { proc.proc, nullptr });
 }
 
-std::ostream& operator<<(std::ostream& os, PositivePrefixProc const& proc) {
-    return os << proc.subject.value << "(" << proc.object.value << ") . " << *proc.proc;
+static void print_proc(std::ostream& os, const PositivePrefixProc& proc, PrintTasks& tasks) {
+    os << proc.subject.value << "(" << proc.object.value << ") . ";
+    tasks.push_back(PrintTask { proc.proc, nullptr });
 }
 
-std::ostream& operator<<(std::ostream& os, NegativePrefixProc const& proc) {
-    return os << proc.subject.value << "'" << proc.object.value << " . " << *proc.proc;
+static void print_proc(std::ostream& os, const NegativePrefixProc& proc, PrintTasks& tasks) {
+    os << proc.subject.value << "'" << proc.object.value << " . ";
+    tasks.push_back(PrintTask { proc.proc, nullptr });
 }
 
-std::ostream& operator<<(std::ostream& os, MatchProc const& proc) {
-    return os << "[" << proc.name1.value << " = " << proc.name2.value << "] " << *proc.proc;
+static void print_proc(std::ostream& os, const MatchProc& proc, PrintTasks& tasks) {
+    os << "[" << proc.name1.value << " = " << proc.name2.value << "] ";
+    tasks.push_back(PrintTask { proc.proc, nullptr });
 }
 
-std::ostream& operator<<(std::ostream& os, RestrictionProc const& proc) {
-    return os << "(^" << proc.name.value << ") " << *proc.proc;
+static void print_proc(std::ostream& os, const RestrictionProc& proc, PrintTasks& tasks) {
+    os << "(^" << proc.name.value << ") ";
+    tasks.push_back(PrintTask { proc.proc, nullptr });
+}
+
+static void print_operands(std::ostream& os, ProcRange operands, const char* separator, PrintTasks& tasks) {
+    os << "(";
+    tasks.push_back(PrintTask { 0, ")" });
+    for (size_t i = operands.size() - 1; i > 0; i--) {
+        tasks.push_back(PrintTask { operands[i], nullptr });
+        tasks.push_back(PrintTask { 0, separator });
+    }
+    tasks.push_back(PrintTask { operands[0], nullptr });
 }
 
-std::ostream& operator<<(std::ostream& os, SumProc const& proc) {
-    return os << "(" << *proc.lhs << " + " << *proc.rhs << ")";
+static void print_proc(std::ostream& os, const SumProc& proc, PrintTasks& tasks) {
+    print_operands(os, proc.operands, " + ", tasks);
 }
 
-std::ostream& operator<<(std::ostream& os, ParallelProc const& proc) {
-    return os << "(" << *proc.lhs << " | " << *proc.rhs << ")";
+static void print_proc(std::ostream& os, const ParallelProc& proc, PrintTasks& tasks) {
+    print_operands(os, proc.operands, " | ", tasks);
 }
 
-std::ostream& operator<<(std::ostream& os, IdentifierProc const& proc) {
+static void print_proc(std::ostream& os, const IdentifierProc& proc, PrintTasks& tasks) {
     os << proc.variable_id.value;
     if (proc.args.size() > 0) {
         os << "(";
@@ -46,17 +71,24 @@ std::ostream& operator<<(std::ostream& os, IdentifierProc const& proc) {
         }
         os << ")";
     }
-    return os;
 }
 
-std::ostream& operator<<(std::ostream& os, Proc const& proc) {
-    const_cast<Proc&>(proc).visit<void>([&](auto& proc) {
-        os << proc;
-    });
-    return os;
+void print_proc(std::ostream& os, const Module& mod, ProcIndex root) {
+    PrintTasks tasks { PrintTask { root, nullptr } };
+    while (!tasks.empty()) {
+        auto task = tasks.back();
+        tasks.pop_back();
+        if (task.text != nullptr) {
+            os << task.text;
+            continue;
+        }
+        mod.visit<void>(task.proc, [&](auto& arg) {
+            print_proc(os, arg, tasks);
+        });
+    }
 }
 
-std::ostream& operator<<(std::ostream& os, ProcDecl const& decl) {
+void print_decl(std::ostream& os, const Module& mod, const ProcDecl& decl) {
     os << "agent " << decl.id.value;
     if (decl.params.size() > 0) {
         os << "(";
@@ -68,13 +100,15 @@ std::ostream& operator<<(std::ostream& os, ProcDecl const& decl) {
         }
         os << ")";
     }
-    os << " = " << *decl.proc << ";";
-    return os;
+    os << " = ";
+    print_proc(os, mod, decl.proc);
+    os << ";";
 }
 
 std::ostream& operator<<(std::ostream& os, Module const& mod) {
     for (auto& decl : mod.declarations) {
-        os << decl << "\n";
+        print_decl(os, mod, decl);
+        os << "\n";
     }
     return os;
 }
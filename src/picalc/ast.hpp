@@ -1,231 +1,317 @@
 #ifndef PICALC_AST_H
 #define PICALC_AST_H
 
+#include "arena.hpp"
 #include "core.hpp"
+#include "symbols.hpp"
 
-#include <memory>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <ostream>
 #include <string>
-#include <variant>
 #include <vector>
 
 namespace picalc {
 
-struct Proc;
+// the index of a process node in a Module
+using ProcIndex = uint32_t;
+
+enum class ProcKind : uint8_t {
+    ZERO,
+    TAU_PREFIX,
+    POSITIVE_PREFIX,
+    NEGATIVE_PREFIX,
+    MATCH,
+    RESTRICTION,
+    SUM,
+    PARALLEL,
+    IDENTIFIER
+};
+
+// the arguments of a call, stored next to each other in Module::call_names
+class IdentifierRange final {
+public:
+    class Iterator final {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Identifier;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Identifier*;
+        using reference = Identifier;
+
+        Iterator(const Symbol* symbol, const SymbolTable* symbols) : symbol(symbol), symbols(symbols) {}
+
+        Identifier operator*() const {
+            return Identifier(*symbol, symbols->get_text(*symbol));
+        }
+
+        Iterator& operator++() {
+            symbol++;
+            return *this;
+        }
+
+        bool operator==(const Iterator& rhs) const {
+            return symbol == rhs.symbol;
+        }
+
+        bool operator!=(const Iterator& rhs) const {
+            return symbol != rhs.symbol;
+        }
+
+    private:
+        const Symbol* symbol;
+        const SymbolTable* symbols;
+    };
+
+    IdentifierRange(const Symbol* first, const Symbol* last, const SymbolTable* symbols) :
+        first(first),
+        last(last),
+        symbols(symbols) {}
+
+    Iterator begin() const {
+        return Iterator(first, symbols);
+    }
+
+    Iterator end() const {
+        return Iterator(last, symbols);
+    }
+
+    size_t size() const {
+        return last - first;
+    }
+
+    Identifier operator[](size_t i) const {
+        return Identifier(first[i], symbols->get_text(first[i]));
+    }
+
+private:
+    const Symbol* first;
+    const Symbol* last;
+    const SymbolTable* symbols;
+};
+
+// the operands of a sum or parallel composition, stored next to each other in
+// Module::operands
+struct ProcRange final {
+    const ProcIndex* first;
+    const ProcIndex* last;
+
+    const ProcIndex* begin() const {
+        return first;
+    }
+
+    const ProcIndex* end() const {
+        return last;
+    }
+
+    size_t size() const {
+        return last - first;
+    }
+
+    ProcIndex operator[](size_t i) const {
+        return first[i];
+    }
+};
+
+// The nodes as Module::visit passes them to a visitor; the children of a node
+// are indices in the same module.
 
 struct ZeroProc final {};
 
 struct TauPrefixProc final {
-    explicit TauPrefixProc(std::unique_ptr<Proc> proc) :
-        proc(std::move(proc)) {}
-
-    std::unique_ptr<Proc> proc;
+    ProcIndex proc;
 };
 
 struct PositivePrefixProc final {
-    explicit PositivePrefixProc(
-        Identifier subject,
-        Identifier object,
-        std::unique_ptr<Proc> proc
-    ) :
-        subject(std::move(subject)),
-        object(std::move(object)),
-        proc(std::move(proc)) {}
-
     Identifier subject;
     Identifier object;
-    std::unique_ptr<Proc> proc;
+    ProcIndex proc;
 };
 
 struct NegativePrefixProc final {
-    explicit NegativePrefixProc(
-        Identifier subject,
-        Identifier object,
-        std::unique_ptr<Proc> proc
-    ) :
-        subject(std::move(subject)),
-        object(std::move(object)),
-        proc(std::move(proc)) {}
-
     Identifier subject;
     Identifier object;
-    std::unique_ptr<Proc> proc;
+    ProcIndex proc;
 };
 
 struct MatchProc final {
-    explicit MatchProc(
-        Identifier name1,
-        Identifier name2,
-        std::unique_ptr<Proc> proc
-    ) :
-        name1(std::move(name1)),
-        name2(std::move(name2)),
-        proc(std::move(proc)) {}
-
     Identifier name1;
     Identifier name2;
-    std::unique_ptr<Proc> proc;
+    ProcIndex proc;
 };
 
 struct RestrictionProc final {
-    explicit RestrictionProc(Identifier name, std::unique_ptr<Proc> proc) :
-        name(std::move(name)),
-        proc(std::move(proc)) {}
-
     Identifier name;
-    std::unique_ptr<Proc> proc;
+    ProcIndex proc;
 };
 
+// a + b + c is one node with three operands, and (a + b) + c is a node with
+// two operands of which the first is a sum
 struct SumProc final {
-    explicit SumProc(std::unique_ptr<Proc> lhs, std::unique_ptr<Proc> rhs) :
-        lhs(std::move(lhs)),
-        rhs(std::move(rhs)) {}
-
-    std::unique_ptr<Proc> lhs;
-    std::unique_ptr<Proc> rhs;
+    ProcRange operands; // at least two
 };
 
 struct ParallelProc final {
-    explicit ParallelProc(std::unique_ptr<Proc> lhs, std::unique_ptr<Proc> rhs) :
-        lhs(std::move(lhs)),
-        rhs(std::move(rhs)) {}
-
-    std::unique_ptr<Proc> lhs;
-    std::unique_ptr<Proc> rhs;
+    ProcRange operands; // at least two
 };
 
 struct IdentifierProc final {
-    explicit IdentifierProc(
-        Identifier variable_id,
-        std::vector<Identifier> args
-    ) :
-        variable_id(std::move(variable_id)),
-        args(std::move(args)) {}
-
     Identifier variable_id;
-    std::vector<Identifier> args;
-};
-
-struct Proc final {
-    explicit Proc(ZeroProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    explicit Proc(TauPrefixProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    explicit Proc(PositivePrefixProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    explicit Proc(NegativePrefixProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    explicit Proc(MatchProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    explicit Proc(RestrictionProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    explicit Proc(SumProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    explicit Proc(ParallelProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    explicit Proc(IdentifierProc proc, SourceLocation loc) :
-        variants(std::move(proc)),
-        loc(loc) {}
-
-    template <typename R, typename T, typename... Args>
-    R visit(T&& visitor, Args&&... args) {
-        // return std::visit(visitor, variants);
-        return std::visit([&](auto&& arg) {
-            using T = std::decay_t<decltype(arg)>;
-            if constexpr (std::is_same_v<T, ZeroProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else if constexpr (std::is_same_v<T, TauPrefixProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else if constexpr (std::is_same_v<T, PositivePrefixProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else if constexpr (std::is_same_v<T, NegativePrefixProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else if constexpr (std::is_same_v<T, MatchProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else if constexpr (std::is_same_v<T, RestrictionProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else if constexpr (std::is_same_v<T, SumProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else if constexpr (std::is_same_v<T, ParallelProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else if constexpr (std::is_same_v<T, IdentifierProc>) {
-                return visitor(arg, std::forward<Args>(args)...);
-            } else {
-                assert(false && "fail");
-            }
-        }, variants);
-    }
-
-    SourceLocation get_loc() const {
-        return loc;
-    }
-
-private:
-    std::variant<
-        ZeroProc,
-        TauPrefixProc,
-        PositivePrefixProc,
-        NegativePrefixProc,
-        MatchProc,
-        RestrictionProc,
-        SumProc,
-        ParallelProc,
-        IdentifierProc
-    > variants;
-
-    SourceLocation loc;
+    IdentifierRange args;
 };
 
 struct ProcDecl final {
     explicit ProcDecl(
         Identifier id,
-        std::vector<Identifier> params,
-        std::unique_ptr<Proc> proc,
+        ArenaVector<Identifier> params,
+        ProcIndex proc,
         SourceLocation loc
     ) :
         id(std::move(id)),
         params(std::move(params)),
-        proc(std::move(proc)),
+        proc(proc),
         loc(loc) {}
 
     ProcDecl(ProcDecl&& rhs) = default;
     ProcDecl& operator=(ProcDecl&& rhs) = default;
 
     Identifier id;
-    std::vector<Identifier> params;
-    std::unique_ptr<Proc> proc;
+    ArenaVector<Identifier> params;
+    ProcIndex proc;
     SourceLocation loc;
 };
 
+// The declarations, and the process terms of all of them as a struct of
+// arrays with one entry per node in `kinds`, `suffixes`, `names` and `locs`.
+// Nodes are added bottom-up, so the children of a node come before it and
+// the nodes of a declaration are contiguous and end with its root; a loop
+// over the indices is a post-order traversal. All of it is allocated in the
+// arena of the compilation.
 struct Module final {
-    explicit Module(std::vector<ProcDecl> declarations) :
-        declarations(std::move(declarations)) {}
+    explicit Module(SymbolTable symbols, Arena& arena) :
+        symbols(std::move(symbols)),
+        declarations(arena),
+        kinds(arena),
+        suffixes(arena),
+        names(arena),
+        locs(arena),
+        call_names(arena),
+        operands(arena) {}
 
     Module(Module&& rhs) = default;
     Module& operator=(Module&& rhs) = default;
 
-    std::vector<ProcDecl> declarations; // it shouldn't need
+    SymbolTable symbols; // of all identifiers in the module
+    ArenaVector<ProcDecl> declarations;
+
+    ArenaVector<ProcKind> kinds;
+    ArenaVector<ProcIndex> suffixes; // of prefixes, matches and restrictions
+    ArenaVector<std::array<Symbol, 2>> names; // see add_call and add_operands for the other nodes
+    ArenaVector<SourceLocation> locs;
+    ArenaVector<Symbol> call_names; // the variable of every call, followed by its arguments
+    ArenaVector<ProcIndex> operands; // of every sum and parallel composition
+
+    ProcIndex add_proc(
+        ProcKind kind,
+        ProcIndex suffix,
+        std::array<Symbol, 2> proc_names,
+        SourceLocation loc
+    ) {
+        kinds.push_back(kind);
+        suffixes.push_back(suffix);
+        names.push_back(proc_names);
+        locs.push_back(loc);
+        return kinds.size() - 1;
+    }
+
+    // names = { index of the variable in call_names, number of arguments }
+    ProcIndex add_call(const Identifier& variable_id, const ArenaVector<Identifier>& args, SourceLocation loc) {
+        uint32_t first = call_names.size();
+        call_names.push_back(variable_id.symbol);
+        for (auto& arg : args) {
+            call_names.push_back(arg.symbol);
+        }
+        return add_proc(ProcKind::IDENTIFIER, 0, { first, static_cast<uint32_t>(args.size()) }, loc);
+    }
+
+    // a sum or parallel composition of the `count` nodes at `proc_operands`;
+    // names = { index of the first operand in operands, number of operands }
+    ProcIndex add_operands(ProcKind kind, const ProcIndex* proc_operands, size_t count, SourceLocation loc) {
+        uint32_t first = operands.size();
+        operands.insert(operands.end(), proc_operands, proc_operands + count);
+        return add_proc(kind, 0, { first, static_cast<uint32_t>(count) }, loc);
+    }
+
+    SourceLocation get_loc(ProcIndex proc) const {
+        return locs[proc];
+    }
+
+    ProcRange get_operands(ProcIndex proc) const {
+        auto first = operands.data() + names[proc][0];
+        return ProcRange { first, first + names[proc][1] };
+    }
+
+    template <typename R, typename T>
+    R visit(ProcIndex proc, T&& visitor) const {
+        auto suffix = suffixes[proc];
+        auto name = [&](size_t i) {
+            return Identifier(names[proc][i], symbols.get_text(names[proc][i]));
+        };
+
+        switch (kinds[proc]) {
+            case ProcKind::ZERO: {
+                const ZeroProc view {};
+                return visitor(view);
+            }
+            case ProcKind::TAU_PREFIX: {
+                const TauPrefixProc view { suffix };
+                return visitor(view);
+            }
+            case ProcKind::POSITIVE_PREFIX: {
+                const PositivePrefixProc view { name(0), name(1), suffix };
+                return visitor(view);
+            }
+            case ProcKind::NEGATIVE_PREFIX: {
+                const NegativePrefixProc view { name(0), name(1), suffix };
+                return visitor(view);
+            }
+            case ProcKind::MATCH: {
+                const MatchProc view { name(0), name(1), suffix };
+                return visitor(view);
+            }
+            case ProcKind::RESTRICTION: {
+                const RestrictionProc view { name(0), suffix };
+                return visitor(view);
+            }
+            case ProcKind::SUM: {
+                const SumProc view { get_operands(proc) };
+                return visitor(view);
+            }
+            case ProcKind::PARALLEL: {
+                const ParallelProc view { get_operands(proc) };
+                return visitor(view);
+            }
+            case ProcKind::IDENTIFIER: {
+                auto first = call_names.data() + names[proc][0];
+                const IdentifierProc view {
+                    Identifier(*first, symbols.get_text(*first)),
+                    IdentifierRange(first + 1, first + 1 + names[proc][1], &symbols)
+                };
+                return visitor(view);
+            }
+        }
+
+        assert(false && "unknown process kind");
+        const ZeroProc view {};
+        return visitor(view);
+    }
 };
 
-std::ostream& operator<<(std::ostream& os, Proc const& decl);
+void print_proc(std::ostream& os, const Module& mod, ProcIndex proc);
 
-std::ostream& operator<<(std::ostream& os, ProcDecl const& decl);
+void print_decl(std::ostream& os, const Module& mod, const ProcDecl& decl);
 
 std::ostream& operator<<(std::ostream& os, Module const& mod);
 
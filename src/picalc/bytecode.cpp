@@ -0,0 +1,143 @@
+#include "bytecode.hpp"
+
+#include "agent.hpp"
+
+#include <iomanip>
+
+namespace picalc {
+
+// also computes `agent_names`, the names of the agent, from those of its
+// operands, so that a binder gets the names of its suffix without traversing it
+static void compile(const AgentPtr& agent, Bytecode& code, NameSet& agent_names) {
+    size_t pc = code.instructions.size();
+    code.instructions.push_back(Instruction { Opcode::ZERO, { 0, 0, 0 } });
+    code.names.emplace_back();
+
+    switch (agent->kind) {
+        case AgentKind::ZERO:
+            break;
+
+        case AgentKind::SUMMATION: {
+            code.instructions[pc].opcode = Opcode::SUM;
+            compile(agent->lhs, code, agent_names);
+            code.instructions[pc].operands[0] = code.instructions.size();
+            NameSet rhs_names;
+            compile(agent->rhs, code, rhs_names);
+            if (rhs_names.size() > agent_names.size()) {
+                agent_names.swap(rhs_names);
+            }
+            agent_names.insert(rhs_names.begin(), rhs_names.end());
+            break;
+        }
+
+        case AgentKind::INPUT_PREFIX:
+            code.instructions[pc] = Instruction {
+                Opcode::INPUT,
+                { agent->name1, agent->name2, agent->lhs.get_index() }
+            };
+            agent_names = names(*agent->lhs);
+            code.names[pc].assign(agent_names.begin(), agent_names.end());
+            agent_names.insert(agent->name1);
+            break;
+
+        case AgentKind::OUTPUT_PREFIX:
+            code.instructions[pc] = Instruction {
+                Opcode::OUTPUT,
+                { agent->name1, agent->name2, agent->lhs.get_index() }
+            };
+            agent_names = names(*agent);
+            break;
+
+        case AgentKind::TAU_PREFIX:
+            code.instructions[pc] = Instruction { Opcode::TAU, { agent->lhs.get_index(), 0, 0 } };
+            agent_names = names(*agent);
+            break;
+
+        case AgentKind::RESTRICTION:
+            code.instructions[pc] = Instruction {
+                Opcode::NEW,
+                { agent->name1, is_free_name(*agent->lhs, agent->name1), 0 }
+            };
+            compile(agent->lhs, code, agent_names);
+            code.names[pc].assign(agent_names.begin(), agent_names.end());
+            break;
+
+        case AgentKind::MATCH:
+            code.instructions[pc] = Instruction { Opcode::MATCH, { agent->name1, agent->name2, 0 } };
+            compile(agent->lhs, code, agent_names);
+            agent_names.insert(agent->name1);
+            agent_names.insert(agent->name2);
+            break;
+
+        case AgentKind::PARALLEL_COMPOSITION:
+            code.instructions[pc] = Instruction { Opcode::PAR, { agent.get_index(), 0, 0 } };
+            agent_names = names(*agent);
+            break;
+
+        case AgentKind::IDENTIFIER:
+            code.instructions[pc] = Instruction { Opcode::CALL, { agent.get_index(), 0, 0 } };
+            agent_names = names(*agent);
+            break;
+    }
+}
+
+Bytecode compile_bytecode(const AgentPtr& body) {
+    Bytecode code;
+    NameSet body_names;
+    compile(body, code, body_names);
+    return code;
+}
+
+void print_bytecode(std::ostream& os, const Bytecode& code) {
+    for (size_t pc = 0; pc < code.instructions.size(); pc++) {
+        auto& instruction = code.instructions[pc];
+        auto& operands = instruction.operands;
+        os << std::setw(6) << pc << "  ";
+        switch (instruction.opcode) {
+            case Opcode::ZERO:
+                os << "ZERO";
+                break;
+            case Opcode::SUM:
+                os << "SUM     " << operands[0];
+                break;
+            case Opcode::INPUT:
+                os << "INPUT   " << operands[0] << ", " << operands[1] << ", @" << operands[2];
+                break;
+            case Opcode::OUTPUT:
+                os << "OUTPUT  " << operands[0] << ", " << operands[1] << ", @" << operands[2];
+                break;
+            case Opcode::TAU:
+                os << "TAU     @" << operands[0];
+                break;
+            case Opcode::NEW:
+                os << "NEW     " << operands[0] << (operands[1] ? "" : ", unused");
+                break;
+            case Opcode::MATCH:
+                os << "MATCH   " << operands[0] << ", " << operands[1];
+                break;
+            case Opcode::PAR:
+                os << "PAR     @" << operands[0];
+                break;
+            case Opcode::CALL: {
+                auto& agent = *AgentPtr(operands[0]);
+                os << "CALL    " << agent.id << "(";
+                for (size_t i = 0; i < agent.args.size(); i++) {
+                    os << (i > 0 ? ", " : "") << agent.args[i];
+                }
+                os << ")";
+                break;
+            }
+        }
+
+        if (!code.names[pc].empty()) {
+            os << "  ; suffix names {";
+            for (size_t i = 0; i < code.names[pc].size(); i++) {
+                os << (i > 0 ? ", " : " ") << code.names[pc][i];
+            }
+            os << " }";
+        }
+        os << "\n";
+    }
+}
+
+} // end namespace picalc
@@ -0,0 +1,46 @@
+#ifndef PICALC_BYTECODE_H
+#define PICALC_BYTECODE_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace picalc {
+
+class AgentPtr;
+
+// The code of a definition body for the IDE rule of the explorer. Only the
+// structure that decides the transitions is compiled: sums, restrictions and
+// matches, with the prefixes, parallel compositions and calls below them as
+// leaves that refer to their subterm by its index in the term store. The
+// instructions are laid out in prefix order, so the first (or only) operand
+// of a node starts at pc + 1.
+enum class Opcode : uint32_t {
+    ZERO,
+    SUM, // the alternatives start at pc + 1 and at operands[0]
+    INPUT, // channel, bound name, suffix
+    OUTPUT, // channel, data, suffix
+    TAU, // suffix
+    NEW, // bound name, whether it is free in the suffix; the suffix starts at pc + 1
+    MATCH, // name, name; the suffix starts at pc + 1
+    PAR, // the whole parallel composition
+    CALL // the whole identifier
+};
+
+struct Instruction final {
+    Opcode opcode;
+    uint32_t operands[3];
+};
+
+struct Bytecode final {
+    std::vector<Instruction> instructions;
+    std::vector<std::vector<uint32_t>> names; // per instruction: the names of the suffix of a binder
+};
+
+Bytecode compile_bytecode(const AgentPtr& body);
+
+void print_bytecode(std::ostream& os, const Bytecode& code);
+
+} // end namespace picalc
+
+#endif
@@ -1,5 +1,7 @@
 #include "cli.hpp"
 
+#include <stdexcept>
+
 namespace picalc {
 
 // very quickly made, not very good quality CLI
@@ -9,6 +11,19 @@ Expected<CliOptions> parse_args(const std::vector<std::string>& args) {
     std::optional<std::string> output_file;
     bool raw_output = false;
     bool verbose = false;
+    bool explore = false;
+    bool congruence = false;
+    bool alpha_canonical = false;
+    bool unique_names = false;
+    bool partial_order = false;
+    bool counting = false;
+    bool dump_bytecode = false;
+    bool nary = false;
+    bool compact = false;
+    Target target = Target::INTERPRETER;
+    std::optional<int> names;
+    int threads = 1;
+    int cache_size = 1 << 16;
 
     int i = 0;
     while (i < args.size()) {
@@ -21,14 +36,110 @@ Expected<CliOptions> parse_args(const std::vector<std::string>& args) {
                         SourceLocation(0, i),
                         "No value given for option --output"
                     ));
-                    continue;
+                    break;
                 }
                 output_file = args[i + 1];
                 i++;
+            } else if (args[i] == "--names") {
+                if (i + 1 >= args.size()) {
+                    errors.push_back(Error(
+                        ErrorType::CLI,
+                        SourceLocation(0, i),
+                        "No value given for option --names"
+                    ));
+                    break;
+                }
+                try {
+                    names = std::stoi(args[i + 1]);
+                } catch (const std::exception&) {
+                    names = 0;
+                }
+                if (*names <= 0) {
+                    errors.push_back(Error(
+                        ErrorType::CLI,
+                        SourceLocation(0, i + 1),
+                        "The number of names should be a positive integer"
+                    ));
+                }
+                i++;
+            } else if (args[i] == "--threads") {
+                if (i + 1 >= args.size()) {
+                    errors.push_back(Error(
+                        ErrorType::CLI,
+                        SourceLocation(0, i),
+                        "No value given for option --threads"
+                    ));
+                    break;
+                }
+                try {
+                    threads = std::stoi(args[i + 1]);
+                } catch (const std::exception&) {
+                    threads = 0;
+                }
+                if (threads <= 0) {
+                    errors.push_back(Error(
+                        ErrorType::CLI,
+                        SourceLocation(0, i + 1),
+                        "The number of threads should be a positive integer"
+                    ));
+                }
+                i++;
+            } else if (args[i] == "--cache-size") {
+                if (i + 1 >= args.size()) {
+                    errors.push_back(Error(
+                        ErrorType::CLI,
+                        SourceLocation(0, i),
+                        "No value given for option --cache-size"
+                    ));
+                    break;
+                }
+                try {
+                    cache_size = std::stoi(args[i + 1]);
+                } catch (const std::exception&) {
+                    cache_size = -1;
+                }
+                if (cache_size < 0) {
+                    errors.push_back(Error(
+                        ErrorType::CLI,
+                        SourceLocation(0, i + 1),
+                        "The cache size should be a non-negative integer"
+                    ));
+                }
+                i++;
             } else if (args[i] == "--raw-output") {
                 raw_output = true;
             } else if (args[i] == "--verbose") {
                 verbose = true;
+            } else if (args[i] == "--explore") {
+                explore = true;
+            } else if (args[i] == "--congruence") {
+                congruence = true;
+            } else if (args[i] == "--alpha-canonical") {
+                alpha_canonical = true;
+            } else if (args[i] == "--unique-names") {
+                unique_names = true;
+            } else if (args[i] == "--por") {
+                partial_order = true;
+            } else if (args[i] == "--counting") {
+                counting = true;
+            } else if (args[i] == "--dump-bytecode") {
+                dump_bytecode = true;
+            } else if (args[i] == "--nary") {
+                nary = true;
+            } else if (args[i] == "--compact") {
+                compact = true;
+            } else if (args[i] == "--target=interpreter") {
+                target = Target::INTERPRETER;
+            } else if (args[i] == "--target=process") {
+                target = Target::PROCESS;
+            } else if (args[i] == "--target=cpp") {
+                target = Target::CPP;
+            } else if (args[i].rfind("--target=", 0) == 0) {
+                errors.push_back(Error(
+                    ErrorType::CLI,
+                    SourceLocation(0, i),
+                    "Unknown target `" + args[i].substr(9) + "`"
+                ));
             }
         } else {
             input_file = args[i];
@@ -51,6 +162,19 @@ Expected<CliOptions> parse_args(const std::vector<std::string>& args) {
         return Expected<CliOptions>(CliOptions {
             raw_output,
             verbose,
+            explore,
+            congruence,
+            alpha_canonical,
+            unique_names,
+            partial_order,
+            counting,
+            dump_bytecode,
+            nary,
+            compact,
+            target,
+            names,
+            threads,
+            cache_size,
             *input_file,
             output_file,
         });
@@ -8,9 +8,28 @@
 
 namespace picalc {
 
+enum class Target {
+    INTERPRETER, // one PiAgent term for PiInterpreter in mcrl2/picalc.mcrl2
+    PROCESS, // process equations using mcrl2/picalc_process.mcrl2
+    CPP // a C++ program that explores the state space, see cppconverter.hpp
+};
+
 struct CliOptions {
     bool raw_output = false;
     bool verbose = false;
+    bool explore = false;
+    bool congruence = false;
+    bool alpha_canonical = false;
+    bool unique_names = false;
+    bool partial_order = false;
+    bool counting = false;
+    bool dump_bytecode = false;
+    bool nary = false; // sums and parallel compositions as lists, for mcrl2/picalc_nary.mcrl2
+    bool compact = false; // generated terms without indentation
+    Target target = Target::INTERPRETER;
+    std::optional<int> names; // overrides the computed bound of pi_names
+    int threads = 1;
+    int cache_size = 1 << 16;
     std::string input_file;
     std::optional<std::string> output_file;
 };
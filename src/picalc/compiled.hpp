@@ -0,0 +1,60 @@
+#ifndef PICALC_COMPILED_H
+#define PICALC_COMPILED_H
+
+#include "driver.hpp"
+#include "explorer.hpp"
+
+#include <initializer_list>
+
+namespace picalc {
+
+// The building blocks of the successor functions that --target=cpp generates;
+// they are the rules of `outgoing` in explorer.cpp, which uses them as well.
+
+// `outgoing` yields a set, so duplicates are removed while keeping the first
+// occurrence; this keeps the generated LTS deterministic
+void remove_duplicates(std::vector<PiTransition>& transitions);
+
+// RES and OPEN; `rec` holds the transitions of the suffix. An unused
+// restriction does not hide the bound actions on its name.
+void outgoing_restriction(
+    PiName name,
+    bool name_is_free,
+    const std::vector<PiTransition>& rec,
+    const ExplorerOptions& options,
+    std::vector<PiTransition>& result
+);
+
+// INPUT, where `data` is already bound in `suffix`
+void outgoing_input(
+    PiName channel,
+    PiName data,
+    const AgentPtr& suffix,
+    const ExplorerOptions& options,
+    std::vector<PiTransition>& result
+);
+
+// substitute_binder in agent.cpp, for a binder whose suffix has the given
+// names: the bound name is kept, unless it is in the range
+inline PiName bind_name(PiName bound_name, std::initializer_list<PiName> suffix_names, const NameSet& range) {
+    if (range.find(bound_name) == range.end()) {
+        return bound_name;
+    }
+
+    NameSet used = range;
+    used.insert(suffix_names);
+    return get_unused_name(used, 0);
+}
+
+// the range of the suffix of a binder that bind_name bound to `name`
+inline NameSet bind_range(const NameSet& range, PiName bound_name, PiName name) {
+    NameSet new_range = range;
+    if (name != bound_name) {
+        new_range.insert(name);
+    }
+    return new_range;
+}
+
+} // end namespace picalc
+
+#endif
@@ -0,0 +1,237 @@
+#include "congruence.hpp"
+
+#include <algorithm>
+#include <optional>
+
+namespace picalc {
+
+int compare_agents(const Agent& lhs, const Agent& rhs) {
+    if (&lhs == &rhs) {
+        return 0;
+    }
+
+    // the hash decides almost every comparison without a traversal
+    if (lhs.kind != rhs.kind) {
+        return lhs.kind < rhs.kind ? -1 : 1;
+    }
+    if (lhs.hash != rhs.hash) {
+        return lhs.hash < rhs.hash ? -1 : 1;
+    }
+    if (lhs.name1 != rhs.name1) {
+        return lhs.name1 < rhs.name1 ? -1 : 1;
+    }
+    if (lhs.name2 != rhs.name2) {
+        return lhs.name2 < rhs.name2 ? -1 : 1;
+    }
+    if (lhs.id != rhs.id) {
+        return lhs.id < rhs.id ? -1 : 1;
+    }
+    if (lhs.args != rhs.args) {
+        return lhs.args < rhs.args ? -1 : 1;
+    }
+    if (lhs.lhs != nullptr) {
+        int result = compare_agents(*lhs.lhs, *rhs.lhs);
+        if (result != 0) {
+            return result;
+        }
+    }
+    if (lhs.rhs != nullptr) {
+        return compare_agents(*lhs.rhs, *rhs.rhs);
+    }
+    return 0;
+}
+
+// collects the operands of nested nodes of the given kind, without zeros
+static void collect_operands(const AgentPtr& agent, AgentKind kind, std::vector<AgentPtr>& result) {
+    if (agent->kind == kind) {
+        collect_operands(agent->lhs, kind, result);
+        collect_operands(agent->rhs, kind, result);
+    } else if (agent->kind != AgentKind::ZERO) {
+        result.push_back(agent);
+    }
+}
+
+// sorts the operands and nests them to the right
+static AgentPtr build_operands(std::vector<AgentPtr> operands, AgentKind kind) {
+    if (operands.empty()) {
+        return make_zero();
+    }
+
+    std::sort(operands.begin(), operands.end(), [](const AgentPtr& lhs, const AgentPtr& rhs) {
+        return compare_agents(*lhs, *rhs) < 0;
+    });
+
+    AgentPtr result = operands.back();
+    for (int i = static_cast<int>(operands.size()) - 2; i >= 0; i--) {
+        result = kind == AgentKind::PARALLEL_COMPOSITION
+            ? make_parallel_composition(operands[i], std::move(result))
+            : make_summation(operands[i], std::move(result));
+    }
+    return result;
+}
+
+// (x) P, where P is already in normal form. The scope of x is not narrowed to
+// the parallel components that use it: x would no longer be free in the other
+// components, which could then receive it as a fresh name, and the states that
+// differ only in that choice would all be explored.
+static AgentPtr normalize_restriction(PiName name, const AgentPtr& suffix) {
+    if (!is_free_name(*suffix, name)) {
+        return suffix;
+    }
+
+    if (suffix->kind == AgentKind::RESTRICTION && suffix->name1 < name) {
+        // (x) (y) P = (y) (x) P; the smallest name goes outside
+        return normalize_restriction(suffix->name1, normalize_restriction(name, suffix->lhs));
+    }
+
+    return make_restriction(name, suffix);
+}
+
+AgentPtr normalize_congruence(const AgentPtr& agent) {
+    switch (agent->kind) {
+        case AgentKind::ZERO:
+        case AgentKind::IDENTIFIER:
+            return agent;
+
+        case AgentKind::SUMMATION:
+        case AgentKind::PARALLEL_COMPOSITION: {
+            std::vector<AgentPtr> operands;
+            collect_operands(agent, agent->kind, operands);
+            for (auto& operand : operands) {
+                operand = normalize_congruence(operand);
+            }
+
+            // normalizing an operand can give a zero or a node of the same kind
+            std::vector<AgentPtr> flattened;
+            for (auto& operand : operands) {
+                collect_operands(operand, agent->kind, flattened);
+            }
+            return build_operands(std::move(flattened), agent->kind);
+        }
+
+        case AgentKind::INPUT_PREFIX:
+            return make_input_prefix(agent->name1, agent->name2, normalize_congruence(agent->lhs));
+        case AgentKind::OUTPUT_PREFIX:
+            return make_output_prefix(agent->name1, agent->name2, normalize_congruence(agent->lhs));
+        case AgentKind::TAU_PREFIX:
+            return make_tau_prefix(normalize_congruence(agent->lhs));
+        case AgentKind::MATCH:
+            return make_match(agent->name1, agent->name2, normalize_congruence(agent->lhs));
+
+        case AgentKind::RESTRICTION:
+            return normalize_restriction(agent->name1, normalize_congruence(agent->lhs));
+    }
+    return agent;
+}
+
+// The names for the binders at each depth: the lowest names that are not free
+// in the agent, found as they are needed.
+struct BinderNames {
+    const Agent& agent;
+    std::vector<PiName> names;
+    PiName next = 0;
+    std::optional<NameSet> free; // collected once the bits of the agent do not suffice
+
+    bool is_free(PiName name) {
+        if (name < NameBits::CAPACITY || !agent.free_name_bits.overflow) {
+            return agent.free_name_bits.contains(name);
+        }
+        if (!free.has_value()) {
+            free = free_names(agent);
+        }
+        return free->find(name) != free->end();
+    }
+
+    PiName at(size_t depth) {
+        while (names.size() <= depth) {
+            while (is_free(next)) {
+                next++;
+            }
+            names.push_back(next++);
+        }
+        return names[depth];
+    }
+};
+
+static AgentPtr rename_bound_names(
+    const AgentPtr& agent,
+    Substitution& sigma,
+    size_t depth,
+    BinderNames& binder_names
+) {
+    auto rename = [&](PiName name) {
+        auto it = sigma.find(name);
+        return it != sigma.end() ? it->second : name;
+    };
+
+    // binds `name` to the name of the current depth within the suffix
+    auto rename_suffix = [&](PiName name, PiName new_name) {
+        auto old = sigma.find(name);
+        std::optional<PiName> old_value;
+        if (old != sigma.end()) {
+            old_value = old->second;
+        }
+        sigma[name] = new_name;
+        auto suffix = rename_bound_names(agent->lhs, sigma, depth + 1, binder_names);
+        if (old_value.has_value()) {
+            sigma[name] = *old_value;
+        } else {
+            sigma.erase(name);
+        }
+        return suffix;
+    };
+
+    switch (agent->kind) {
+        case AgentKind::ZERO:
+            return agent;
+        case AgentKind::SUMMATION:
+            return make_summation(
+                rename_bound_names(agent->lhs, sigma, depth, binder_names),
+                rename_bound_names(agent->rhs, sigma, depth, binder_names)
+            );
+        case AgentKind::PARALLEL_COMPOSITION:
+            return make_parallel_composition(
+                rename_bound_names(agent->lhs, sigma, depth, binder_names),
+                rename_bound_names(agent->rhs, sigma, depth, binder_names)
+            );
+        case AgentKind::INPUT_PREFIX: {
+            auto channel = rename(agent->name1);
+            auto new_name = binder_names.at(depth);
+            return make_input_prefix(channel, new_name, rename_suffix(agent->name2, new_name));
+        }
+        case AgentKind::OUTPUT_PREFIX:
+            return make_output_prefix(
+                rename(agent->name1),
+                rename(agent->name2),
+                rename_bound_names(agent->lhs, sigma, depth, binder_names)
+            );
+        case AgentKind::TAU_PREFIX:
+            return make_tau_prefix(rename_bound_names(agent->lhs, sigma, depth, binder_names));
+        case AgentKind::RESTRICTION: {
+            auto new_name = binder_names.at(depth);
+            return make_restriction(new_name, rename_suffix(agent->name1, new_name));
+        }
+        case AgentKind::MATCH:
+            return make_match(
+                rename(agent->name1),
+                rename(agent->name2),
+                rename_bound_names(agent->lhs, sigma, depth, binder_names)
+            );
+        case AgentKind::IDENTIFIER: {
+            std::vector<PiName> args;
+            for (auto arg : agent->args) {
+                args.push_back(rename(arg));
+            }
+            return make_identifier(agent->id, std::move(args));
+        }
+    }
+    return agent;
+}
+
+AgentPtr canonical_names(const AgentPtr& agent) {
+    Substitution sigma;
+    BinderNames binder_names { *agent };
+    return rename_bound_names(agent, sigma, 0, binder_names);
+}
+
+} // end namespace picalc
@@ -0,0 +1,30 @@
+#ifndef PICALC_CONGRUENCE_H
+#define PICALC_CONGRUENCE_H
+
+#include "agent.hpp"
+
+namespace picalc {
+
+// A total order on agents that only depends on their structure, so that
+// sorting operands gives the same result for equal states in every run.
+int compare_agents(const Agent& lhs, const Agent& rhs);
+
+// Rewrites an agent into a normal form modulo structural congruence:
+//  - nested `|` and `+` are flattened, their operands sorted and zeros removed,
+//  - restrictions on names that are not free are removed,
+//  - adjacent restrictions are sorted by name.
+// Congruent agents usually get the same normal form, but it is not complete:
+// for instance, alpha-equivalent agents keep their different names.
+AgentPtr normalize_congruence(const AgentPtr& agent);
+
+// Renames every bound name to the lowest name that is not free in the agent
+// and not bound by an enclosing binder, so that alpha-equivalent agents become
+// equal. The bound names stay among the lowest names, like the names that the
+// INPUT and OPEN rules pick, so the restrictions keep the same number of names
+// from being picked. The names only depend on the depth of a binder, so sorted
+// operands remain sorted up to their new names.
+AgentPtr canonical_names(const AgentPtr& agent);
+
+} // end namespace picalc
+
+#endif
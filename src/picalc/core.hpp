@@ -2,9 +2,11 @@
 #define PICALC_CORE_H
 
 #include <cassert>
+#include <cstdint>
 #include <optional>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -21,20 +23,26 @@ struct SourceLocation final {
 
 std::ostream& operator<<(std::ostream& os, SourceLocation const& loc);
 
+// the index of an identifier in the SymbolTable of the compilation
+using Symbol = uint32_t;
+
+// the characters are a view into the input of the compilation
 struct Identifier final {
-    explicit Identifier(std::string value) : value(std::move(value)) {}
+    explicit Identifier(Symbol symbol, std::string_view value) : symbol(symbol), value(value) {}
 
-    std::string value;
+    Symbol symbol;
+    std::string_view value;
 
     bool operator==(const Identifier& rhs) const {
-        return value == rhs.value;
+        return symbol == rhs.symbol;
     }
 };
 
 enum class ErrorType {
     CLI,
     SYNTAX,
-    IDENTIFIER
+    IDENTIFIER,
+    UNSUPPORTED
 };
 
 struct Error final {
@@ -83,7 +91,7 @@ namespace std {
     template<>
     struct hash<picalc::Identifier> {
         size_t operator()(const picalc::Identifier& id) const {
-            return hash<std::string>()(id.value);
+            return hash<picalc::Symbol>()(id.symbol);
         }
     };
 }
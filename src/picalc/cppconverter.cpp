@@ -0,0 +1,401 @@
+#include "cppconverter.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace picalc {
+
+// name -> C++ expression holding its value
+using Environment = std::unordered_map<PiName, std::string>;
+
+static void add_line(const std::string& line, CppConverterState& state) {
+    for (int i = 0; i < state.indentation_counter; i++) {
+        state.output += state.indentation_string;
+    }
+    state.output += line;
+    state.output += "\n";
+}
+
+static std::string get_variable(const std::string& prefix, CppConverterState& state) {
+    return prefix + std::to_string(state.variable_counter++);
+}
+
+// `substitute_name` in agent.cpp; names that are not bound stay the same
+static std::string get_name(PiName name, const Environment& env) {
+    auto it = env.find(name);
+    return it == env.end() ? std::to_string(name) : it->second;
+}
+
+static std::string get_name_list(const NameSet& names) {
+    std::string result = "{";
+    for (auto name : names) {
+        result += (result.size() > 1 ? ", " : " ") + std::to_string(name);
+    }
+    return result + " }";
+}
+
+// whether substituting in the agent needs the range
+static bool has_binder(const AgentPtr& agent) {
+    switch (agent->kind) {
+        case AgentKind::INPUT_PREFIX:
+        case AgentKind::RESTRICTION:
+            return true;
+        case AgentKind::ZERO:
+        case AgentKind::IDENTIFIER:
+            return false;
+        default:
+            return has_binder(agent->lhs) || (agent->rhs != nullptr && has_binder(agent->rhs));
+    }
+}
+
+// substitute_binder; updates `env` and `range` for the suffix
+static std::string convert_binder(
+    PiName bound_name,
+    const AgentPtr& suffix,
+    Environment& env,
+    std::string& range,
+    CppConverterState& state
+) {
+    auto name = get_variable("n", state);
+    add_line(
+        "PiName " + name + " = bind_name(" + std::to_string(bound_name) + ", " +
+            get_name_list(names(*suffix)) + ", " + range + ");",
+        state
+    );
+    if (has_binder(suffix)) {
+        auto new_range = get_variable("range", state);
+        add_line(
+            "NameSet " + new_range + " = bind_range(" + range + ", " + std::to_string(bound_name) + ", " + name + ");",
+            state
+        );
+        range = new_range;
+    }
+    env[bound_name] = name;
+    return name;
+}
+
+static std::string add_agent(const std::string& expression, CppConverterState& state) {
+    auto agent = get_variable("a", state);
+    add_line("AgentPtr " + agent + " = " + expression + ";", state);
+    return agent;
+}
+
+// substitute_rec; returns the variable holding the agent
+static std::string convert_agent(
+    const AgentPtr& agent,
+    const Environment& env,
+    const std::string& range,
+    CppConverterState& state
+) {
+    switch (agent->kind) {
+        case AgentKind::ZERO:
+            return add_agent("make_zero()", state);
+
+        case AgentKind::SUMMATION:
+        case AgentKind::PARALLEL_COMPOSITION: {
+            auto lhs = convert_agent(agent->lhs, env, range, state);
+            auto rhs = convert_agent(agent->rhs, env, range, state);
+            return add_agent(
+                std::string(agent->kind == AgentKind::SUMMATION ? "make_summation(" : "make_parallel_composition(") +
+                    lhs + ", " + rhs + ")",
+                state
+            );
+        }
+
+        case AgentKind::INPUT_PREFIX: {
+            auto channel = get_name(agent->name1, env);
+            Environment new_env = env;
+            std::string new_range = range;
+            auto data = convert_binder(agent->name2, agent->lhs, new_env, new_range, state);
+            auto suffix = convert_agent(agent->lhs, new_env, new_range, state);
+            return add_agent("make_input_prefix(" + channel + ", " + data + ", " + suffix + ")", state);
+        }
+
+        case AgentKind::OUTPUT_PREFIX: {
+            auto suffix = convert_agent(agent->lhs, env, range, state);
+            return add_agent(
+                "make_output_prefix(" + get_name(agent->name1, env) + ", " + get_name(agent->name2, env) +
+                    ", " + suffix + ")",
+                state
+            );
+        }
+
+        case AgentKind::TAU_PREFIX: {
+            auto suffix = convert_agent(agent->lhs, env, range, state);
+            return add_agent("make_tau_prefix(" + suffix + ")", state);
+        }
+
+        case AgentKind::RESTRICTION: {
+            Environment new_env = env;
+            std::string new_range = range;
+            auto name = convert_binder(agent->name1, agent->lhs, new_env, new_range, state);
+            auto suffix = convert_agent(agent->lhs, new_env, new_range, state);
+            return add_agent("make_restriction(" + name + ", " + suffix + ")", state);
+        }
+
+        case AgentKind::MATCH: {
+            auto suffix = convert_agent(agent->lhs, env, range, state);
+            return add_agent(
+                "make_match(" + get_name(agent->name1, env) + ", " + get_name(agent->name2, env) +
+                    ", " + suffix + ")",
+                state
+            );
+        }
+
+        case AgentKind::IDENTIFIER: {
+            std::string args;
+            for (auto arg : agent->args) {
+                args += (args.empty() ? "" : ", ") + get_name(arg, env);
+            }
+            return add_agent(
+                "make_identifier(" + std::to_string(agent->id) + ", { " + args + " })",
+                state
+            );
+        }
+    }
+    return "";
+}
+
+// outgoing_code; adds the transitions of the agent to `result`
+static void convert_outgoing(
+    const AgentPtr& agent,
+    const Environment& env,
+    const std::string& range,
+    const std::string& result,
+    CppConverterState& state
+) {
+    auto open_block = [&]() {
+        add_line("{", state);
+        state.indentation_counter++;
+    };
+    auto close_block = [&]() {
+        state.indentation_counter--;
+        add_line("}", state);
+    };
+
+    switch (agent->kind) {
+        case AgentKind::ZERO:
+            break;
+
+        // SUM
+        case AgentKind::SUMMATION:
+            convert_outgoing(agent->lhs, env, range, result, state);
+            convert_outgoing(agent->rhs, env, range, result, state);
+            break;
+
+        // INPUT
+        case AgentKind::INPUT_PREFIX: {
+            open_block();
+            auto channel = get_name(agent->name1, env);
+            Environment new_env = env;
+            std::string new_range = range;
+            auto data = convert_binder(agent->name2, agent->lhs, new_env, new_range, state);
+            auto suffix = convert_agent(agent->lhs, new_env, new_range, state);
+            add_line("outgoing_input(" + channel + ", " + data + ", " + suffix + ", options, " + result + ");", state);
+            close_block();
+            break;
+        }
+
+        // OUTPUT
+        case AgentKind::OUTPUT_PREFIX: {
+            open_block();
+            auto suffix = convert_agent(agent->lhs, env, range, state);
+            add_line(
+                result + ".push_back(PiTransition { PiAction { ActionKind::FREE_OUTPUT, " +
+                    get_name(agent->name1, env) + ", " + get_name(agent->name2, env) + " }, " + suffix + " });",
+                state
+            );
+            close_block();
+            break;
+        }
+
+        // TAU
+        case AgentKind::TAU_PREFIX: {
+            open_block();
+            auto suffix = convert_agent(agent->lhs, env, range, state);
+            add_line(result + ".push_back(PiTransition { PiAction { ActionKind::TAU, 0, 0 }, " + suffix + " });", state);
+            close_block();
+            break;
+        }
+
+        // RES, OPEN
+        case AgentKind::RESTRICTION: {
+            open_block();
+            Environment new_env = env;
+            std::string new_range = range;
+            auto name = convert_binder(agent->name1, agent->lhs, new_env, new_range, state);
+            auto rec = get_variable("rec", state);
+            add_line("std::vector<PiTransition> " + rec + ";", state);
+            convert_outgoing(agent->lhs, new_env, new_range, rec, state);
+            add_line("remove_duplicates(" + rec + ");", state);
+            std::string name_is_free = is_free_name(*agent->lhs, agent->name1) ? "true" : "false";
+            add_line(
+                "outgoing_restriction(" + name + ", " + name_is_free + ", " + rec + ", options, " + result + ");",
+                state
+            );
+            close_block();
+            break;
+        }
+
+        // MATCH
+        case AgentKind::MATCH: {
+            auto name1 = get_name(agent->name1, env);
+            auto name2 = get_name(agent->name2, env);
+            if (name1 == name2) {
+                convert_outgoing(agent->lhs, env, range, result, state);
+                break;
+            }
+            add_line("if (" + name1 + " == " + name2 + ") {", state);
+            state.indentation_counter++;
+            convert_outgoing(agent->lhs, env, range, result, state);
+            state.indentation_counter--;
+            add_line("}", state);
+            break;
+        }
+
+        // the transitions of parallel compositions and calls depend on their
+        // whole agent anyway
+        case AgentKind::PARALLEL_COMPOSITION:
+        case AgentKind::IDENTIFIER: {
+            open_block();
+            auto next = convert_agent(agent, env, range, state);
+            auto rec = get_variable("rec", state);
+            add_line("auto " + rec + " = outgoing(program, " + next + ", options, cache);", state);
+            add_line(result + ".insert(" + result + ".end(), " + rec + ".begin(), " + rec + ".end());", state);
+            close_block();
+            break;
+        }
+    }
+}
+
+// a raw string literal holding the text
+static std::string get_raw_string(std::string_view text) {
+    std::string delimiter = "picalc";
+    while (text.find(")" + delimiter + "\"") != std::string_view::npos) {
+        delimiter += "_";
+    }
+    return "R\"" + delimiter + "(" + std::string(text) + ")" + delimiter + "\"";
+}
+
+// The generated code nests a block or an expression for every level of an
+// agent, which compilers and the recursive functions below only handle up to
+// a point.
+static const size_t max_cpp_depth = 1000;
+
+Expected<std::string> convert_module_to_cpp(
+    const Module& module,
+    std::string_view source,
+    PiName names_bound,
+    bool unique_names
+) {
+    // checked before the conversion to agents, which is recursive as well
+    std::vector<Error> errors;
+    auto depths = get_agent_depths(module);
+    for (size_t i = 0; i < module.declarations.size(); i++) {
+        if (depths[i] > max_cpp_depth) {
+            errors.push_back(Error(
+                ErrorType::UNSUPPORTED,
+                module.declarations[i].loc,
+                "Agent `" + std::string(module.declarations[i].id.value) + "` is nested more than " +
+                    std::to_string(max_cpp_depth) + " deep, which the C++ target does not support"
+            ));
+        }
+    }
+    if (!errors.empty()) {
+        return Expected<std::string>(std::move(errors));
+    }
+
+    auto expected_program = convert_module_to_agents(module, names_bound, unique_names);
+    if (!expected_program.has_value()) {
+        return Expected<std::string>(std::move(expected_program.errors));
+    }
+    auto& program = *expected_program;
+
+    CppConverterState state {};
+    state.indentation_string = "    ";
+
+    add_line("// Generated by pi2mcrl2 --target=cpp. Build it against the picalc library, e.g.", state);
+    add_line("//     c++ -O3 -std=c++17 -I <pi2mcrl2>/src <this file> <build>/libpicalc.a -pthread", state);
+    add_line("// and run it with the options of pi2mcrl2 --explore.", state);
+    add_line("", state);
+    add_line("#include \"picalc/compiled.hpp\"", state);
+    add_line("", state);
+    add_line("using namespace picalc;", state);
+    add_line("", state);
+    add_line("namespace {", state);
+    add_line("", state);
+    add_line("constexpr PiName NAMES_BOUND = " + std::to_string(names_bound) + ";", state);
+    add_line(std::string("constexpr bool UNIQUE_NAMES = ") + (unique_names ? "true" : "false") + ";", state);
+    add_line("constexpr const char* SOURCE = " + get_raw_string(source) + ";", state);
+    add_line("", state);
+    add_line("template <PiIdentifier Id>", state);
+    add_line("void successors(", state);
+    add_line("    const PiProgram& program,", state);
+    add_line("    const std::vector<PiName>& args,", state);
+    add_line("    const ExplorerOptions& options,", state);
+    add_line("    TransitionCache* cache,", state);
+    add_line("    std::vector<PiTransition>& result", state);
+    add_line(");", state);
+
+    for (PiIdentifier id = 0; id < program.definitions.size(); id++) {
+        auto& def = program.definitions[id];
+        std::ostringstream decl;
+        print_decl(decl, module, module.declarations[id]);
+        auto comment = decl.str();
+        std::replace(comment.begin(), comment.end(), '\n', ' ');
+
+        add_line("", state);
+        add_line("// " + comment, state);
+        add_line("template <>", state);
+        add_line("void successors<" + std::to_string(id) + ">(", state);
+        add_line("    const PiProgram& program,", state);
+        add_line("    const std::vector<PiName>& args,", state);
+        add_line("    const ExplorerOptions& options,", state);
+        add_line("    TransitionCache* cache,", state);
+        add_line("    std::vector<PiTransition>& result", state);
+        add_line(") {", state);
+        state.indentation_counter++;
+
+        // the IDE rule: sigma maps the params to the args, and the range holds both
+        state.variable_counter = 0;
+        Environment env;
+        std::string range_names;
+        for (PiName i = 0; i < def.arity; i++) {
+            auto name = get_variable("n", state);
+            add_line("PiName " + name + " = args[" + std::to_string(i) + "];", state);
+            env[i] = name;
+            range_names += std::to_string(i) + ", ";
+        }
+        for (PiName i = 0; i < def.arity; i++) {
+            range_names += env[i] + (i + 1 < def.arity ? ", " : "");
+        }
+        std::string range;
+        if (has_binder(def.agent)) {
+            range = get_variable("range", state);
+            add_line("NameSet " + range + (def.arity > 0 ? " { " + range_names + " }" : "") + ";", state);
+        }
+        convert_outgoing(def.agent, env, range, "result", state);
+
+        state.indentation_counter--;
+        add_line("}", state);
+    }
+
+    add_line("", state);
+    add_line("} // end anonymous namespace", state);
+    add_line("", state);
+    add_line("int main(int argc, char** argv) {", state);
+    state.indentation_counter++;
+    add_line("return run_compiled_explorer(argc, argv, SOURCE, NAMES_BOUND, UNIQUE_NAMES, {", state);
+    state.indentation_counter++;
+    for (PiIdentifier id = 0; id < program.definitions.size(); id++) {
+        add_line("successors<" + std::to_string(id) + ">,", state);
+    }
+    state.indentation_counter--;
+    add_line("});", state);
+    state.indentation_counter--;
+    add_line("}", state);
+
+    return state.output;
+}
+
+} // end namespace picalc
@@ -0,0 +1,31 @@
+#ifndef PICALC_CPPCONVERTER_H
+#define PICALC_CPPCONVERTER_H
+
+#include "agent.hpp"
+
+namespace picalc {
+
+struct CppConverterState {
+    std::string indentation_string;
+    int indentation_counter;
+    std::string output;
+    int variable_counter; // for the names of C++ variables
+};
+
+// Compiles every definition into a specialization `successors<id>` of the
+// IDE rule of the explorer, and the model into a C++ program that explores it
+// with run_compiled_explorer. The successor functions are outgoing_code in
+// explorer.cpp unrolled over the body: names are local variables, the names
+// of suffixes and the structure of the agents they build are constants, and
+// only the alpha-conversion of binders is decided at run time. The generated
+// program is linked against the picalc library.
+Expected<std::string> convert_module_to_cpp(
+    const Module& module,
+    std::string_view source,
+    PiName names_bound,
+    bool unique_names
+);
+
+} // end namespace picalc
+
+#endif
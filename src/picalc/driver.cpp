@@ -0,0 +1,107 @@
+#include "driver.hpp"
+
+#include "lexer.hpp"
+#include "parser.hpp"
+
+#include <iostream>
+
+namespace picalc {
+
+static void print_errors(const std::vector<Error>& errors) {
+    for (auto& error : errors) {
+        std::cerr << error.loc << ": " << error.message << "\n";
+    }
+}
+
+int run_explorer(
+    const PiProgram& program,
+    const CliOptions& options,
+    PiName names_bound,
+    std::vector<CompiledOutgoing> compiled
+) {
+    ExplorerOptions explorer_options;
+    explorer_options.names_bound = names_bound;
+    explorer_options.congruence = options.congruence || options.counting;
+    explorer_options.alpha_canonical = options.alpha_canonical;
+    explorer_options.partial_order = options.partial_order;
+    explorer_options.counting = options.counting;
+    explorer_options.threads = options.threads;
+    explorer_options.cache_size = options.cache_size;
+    explorer_options.compiled = std::move(compiled);
+    auto lts = explore(program, explorer_options);
+    if (options.verbose) {
+        std::cerr << "[verbose] states: " << lts.num_states
+            << ", transitions: " << lts.transitions.size() << "\n";
+        std::cerr << "[verbose] distinct agent nodes: " << term_store().size() << "\n";
+        auto& statistics = lts.cache_statistics;
+        std::cerr << "[verbose] transition cache: " << statistics.hits << " hits, "
+            << statistics.misses << " misses, " << statistics.evictions << " evictions\n";
+        if (options.counting) {
+            auto& counting = lts.counting_statistics;
+            double factor = counting.components == counting.copies
+                ? 1.0
+                : static_cast<double>(counting.components) / (counting.components - counting.copies);
+            std::cerr << "[verbose] counting: " << counting.copies << " of " << counting.components
+                << " components left out as copies, reduction factor " << factor << "\n";
+        }
+    }
+
+    auto output = options.output_file.has_value()
+        ? OutputSink::open(*options.output_file)
+        : OutputSink::standard_output();
+    if (!output.has_value()) {
+        print_errors(output.errors);
+        return 1;
+    }
+    write_aut(*output, lts);
+    auto written = (*output).commit();
+    if (!written.has_value()) {
+        print_errors(written.errors);
+        return 1;
+    }
+    return 0;
+}
+
+int run_compiled_explorer(
+    int argc,
+    char** argv,
+    const char* source,
+    PiName names_bound,
+    bool unique_names,
+    std::vector<CompiledOutgoing> compiled
+) {
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        args.push_back(argv[i]);
+    }
+    args.push_back(argv[0]); // stands in for the input file, which is compiled in
+
+    auto options = parse_args(args);
+    if (!options.has_value()) {
+        print_errors(options.errors);
+        return 1;
+    }
+
+    // the model was checked when it was compiled, so these cannot fail
+    Arena arena;
+    SymbolTable symbols(arena);
+    auto tokens = tokenize(source, arena, symbols);
+    if (!tokens.has_value()) {
+        print_errors(tokens.errors);
+        return 1;
+    }
+    auto mod = parse_module(std::move(*tokens), std::move(symbols), arena);
+    if (!mod.has_value()) {
+        print_errors(mod.errors);
+        return 1;
+    }
+    auto program = convert_module_to_agents(*mod, names_bound, unique_names);
+    if (!program.has_value()) {
+        print_errors(program.errors);
+        return 1;
+    }
+
+    return run_explorer(*program, *options, names_bound, std::move(compiled));
+}
+
+} // end namespace picalc
@@ -0,0 +1,33 @@
+#ifndef PICALC_DRIVER_H
+#define PICALC_DRIVER_H
+
+#include "cli.hpp"
+#include "explorer.hpp"
+
+namespace picalc {
+
+// The --explore mode of pi2mcrl2: generates the LTS of the program with the
+// given options and writes it as an .aut file. Returns the exit code.
+int run_explorer(
+    const PiProgram& program,
+    const CliOptions& options,
+    PiName names_bound,
+    std::vector<CompiledOutgoing> compiled = {}
+);
+
+// The main function of the explorers generated by --target=cpp. The model is
+// parsed again from its source to build the definitions, with the names bound
+// and numbering it was compiled for; the command line takes the options of
+// --explore, but not --names or --unique-names.
+int run_compiled_explorer(
+    int argc,
+    char** argv,
+    const char* source,
+    PiName names_bound,
+    bool unique_names,
+    std::vector<CompiledOutgoing> compiled
+);
+
+} // end namespace picalc
+
+#endif
@@ -0,0 +1,1003 @@
+#include "explorer.hpp"
+
+#include "compiled.hpp"
+#include "congruence.hpp"
+#include "transitioncache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace picalc {
+
+// the label that lps2lts gives the action
+static void append_action(OutputSink& output, const PiAction& action) {
+    output += "pi_action(";
+    switch (action.kind) {
+        case ActionKind::FREE_INPUT:
+            output += "free_input_action(";
+            break;
+        case ActionKind::BOUND_INPUT:
+            output += "bound_input_action(";
+            break;
+        case ActionKind::FREE_OUTPUT:
+            output += "free_output_action(";
+            break;
+        case ActionKind::BOUND_OUTPUT:
+            output += "bound_output_action(";
+            break;
+        case ActionKind::TAU:
+            output += "tau_action)";
+            return;
+    }
+    output.append_number(action.channel);
+    output += ", ";
+    output.append_number(action.data);
+    output += "))";
+}
+
+static bool is_bound_action(const PiAction& action) {
+    return action.kind == ActionKind::BOUND_INPUT || action.kind == ActionKind::BOUND_OUTPUT;
+}
+
+// names_action in the specification
+static bool action_has_name(const PiAction& action, PiName name) {
+    return action.kind != ActionKind::TAU && (action.channel == name || action.data == name);
+}
+
+struct PiTransitionHash {
+    size_t operator()(const PiTransition& transition) const {
+        size_t hash = static_cast<size_t>(transition.action.kind);
+        hash = hash * 31 + transition.action.channel;
+        hash = hash * 31 + transition.action.data;
+        return hash * 31 + transition.next_agent->hash;
+    }
+};
+
+struct PiTransitionEqual {
+    bool operator()(const PiTransition& lhs, const PiTransition& rhs) const {
+        return lhs.action == rhs.action && *lhs.next_agent == *rhs.next_agent;
+    }
+};
+
+// `outgoing` yields a set, so duplicates are removed while keeping the first
+// occurrence; this keeps the generated LTS deterministic
+void remove_duplicates(std::vector<PiTransition>& transitions) {
+    if (transitions.size() < 2) {
+        return;
+    }
+
+    std::unordered_set<PiTransition, PiTransitionHash, PiTransitionEqual> seen;
+    std::vector<PiTransition> result;
+    result.reserve(transitions.size());
+    for (auto& transition : transitions) {
+        if (seen.insert(transition).second) {
+            result.push_back(std::move(transition));
+        }
+    }
+    transitions = std::move(result);
+}
+
+// COM and CLOSE; the sending side always ends up on the left, because the
+// specification builds parallel_composition(next_agent(transition1), ...)
+static void synchronize(
+    const std::vector<PiTransition>& senders,
+    const std::vector<PiTransition>& receivers,
+    std::vector<PiTransition>& result
+) {
+    for (auto& transition1 : senders) {
+        auto& output = transition1.action;
+        if (output.kind != ActionKind::FREE_OUTPUT && output.kind != ActionKind::BOUND_OUTPUT) {
+            continue;
+        }
+        for (auto& transition2 : receivers) {
+            auto& input = transition2.action;
+            if (input.kind != ActionKind::BOUND_INPUT || input.channel != output.channel) {
+                continue;
+            }
+
+            if (output.kind == ActionKind::FREE_OUTPUT) {
+                // COM: P | Q --(tau)-> P' | Q'[c -> b]
+                result.push_back(PiTransition {
+                    PiAction { ActionKind::TAU, 0, 0 },
+                    make_parallel_composition(
+                        transition1.next_agent,
+                        substitute_single(transition2.next_agent, input.data, output.data)
+                    )
+                });
+            } else if (input.data == output.data) {
+                // CLOSE: P | Q --(tau)-> (b)(P' | Q')
+                result.push_back(PiTransition {
+                    PiAction { ActionKind::TAU, 0, 0 },
+                    make_restriction(
+                        output.data,
+                        make_parallel_composition(transition1.next_agent, transition2.next_agent)
+                    )
+                });
+            }
+        }
+    }
+}
+
+// the first operand of a parallel composition nested to the right
+static AgentPtr head_operand(const AgentPtr& agent) {
+    return agent->kind == AgentKind::PARALLEL_COMPOSITION ? agent->lhs : agent;
+}
+
+// `rec1` and `rec2` hold the transitions of the operands
+static void outgoing_parallel_composition(
+    const Agent& agent,
+    const std::vector<PiTransition>& rec1,
+    const std::vector<PiTransition>& rec2,
+    std::vector<PiTransition>& result
+) {
+    auto is_disjoint_with = [](const PiAction& action, const AgentPtr& other) {
+        if (!is_bound_action(action)) {
+            return true;
+        }
+        return !is_free_name(*other, action.data);
+    };
+
+    // PAR (take only left transition)
+    for (auto& transition : rec1) {
+        if (is_disjoint_with(transition.action, agent.rhs)) {
+            result.push_back(PiTransition {
+                transition.action,
+                make_parallel_composition(transition.next_agent, agent.rhs)
+            });
+        }
+    }
+
+    // PAR (take only right transition)
+    for (auto& transition : rec2) {
+        if (is_disjoint_with(transition.action, agent.lhs)) {
+            result.push_back(PiTransition {
+                transition.action,
+                make_parallel_composition(agent.lhs, transition.next_agent)
+            });
+        }
+    }
+
+    synchronize(rec1, rec2, result);
+    synchronize(rec2, rec1, result);
+}
+
+// The transitions of P | (P | R) or P | P, in which the left copy of P is
+// left out: its transitions lead to the same states modulo structural
+// congruence as those of the right copy, whose bound names are checked
+// against fewer operands. Only the synchronizations between the two copies
+// are added, if the right one is the last copy.
+static void outgoing_copies(
+    const PiProgram& program,
+    const Agent& agent,
+    const ExplorerOptions& options,
+    TransitionCache* cache,
+    std::vector<PiTransition>& result
+) {
+    outgoing_parallel_composition(agent, {}, outgoing(program, agent.rhs, options, cache), result);
+
+    bool has_tail = agent.rhs->kind == AgentKind::PARALLEL_COMPOSITION;
+    if (has_tail && head_operand(agent.rhs->rhs) == agent.lhs) {
+        return;
+    }
+
+    // the transitions of the right copy alone, within the right operand
+    auto rec1 = outgoing(program, agent.lhs, options, cache);
+    std::vector<PiTransition> rec2;
+    if (has_tail) {
+        outgoing_parallel_composition(*agent.rhs, rec1, {}, rec2);
+    } else {
+        rec2 = rec1;
+    }
+
+    // both copies are the same, so one direction gives all states
+    synchronize(rec1, rec2, result);
+}
+
+void outgoing_restriction(
+    PiName name,
+    bool name_is_free,
+    const std::vector<PiTransition>& rec,
+    const ExplorerOptions& options,
+    std::vector<PiTransition>& result
+) {
+    // RES
+    for (auto& transition : rec) {
+        if (!action_has_name(transition.action, name)) {
+            result.push_back(PiTransition {
+                transition.action,
+                make_restriction(name, transition.next_agent)
+            });
+        } else if (!name_is_free) {
+            // the action can only receive or extrude the name, and the unused
+            // restriction can be renamed out of its way and left out
+            result.push_back(transition);
+        }
+    }
+
+    // OPEN: (y) P --(x'(w))-> P'[y -> w]
+    for (auto& transition : rec) {
+        auto& action = transition.action;
+        if (action.kind != ActionKind::FREE_OUTPUT || action.data != name || action.channel == name) {
+            continue;
+        }
+
+        // w is not in free_names((y) P')
+        for (PiName w = 0; w < options.names_bound; w++) {
+            if (w != name && is_free_name(*transition.next_agent, w)) {
+                continue;
+            }
+            result.push_back(PiTransition {
+                PiAction { ActionKind::BOUND_OUTPUT, action.channel, w },
+                substitute_single(transition.next_agent, name, w)
+            });
+        }
+    }
+}
+
+void outgoing_input(
+    PiName channel,
+    PiName data,
+    const AgentPtr& suffix,
+    const ExplorerOptions& options,
+    std::vector<PiTransition>& result
+) {
+    // the received name is not in free_names((data) suffix)
+    for (PiName name = 0; name < options.names_bound; name++) {
+        if (name != data && is_free_name(*suffix, name)) {
+            continue;
+        }
+        result.push_back(PiTransition {
+            PiAction { ActionKind::BOUND_INPUT, channel, name },
+            substitute_single(suffix, data, name)
+        });
+    }
+}
+
+// substitute_binder in agent.cpp, with the names of the suffix looked up;
+// pop_binder undoes it
+static BinderChange bind_name(
+    PiName bound_name,
+    const std::vector<PiName>& suffix_names,
+    Substitution& sigma,
+    NameSet& range
+) {
+    PiName name = bound_name;
+    if (range.find(bound_name) != range.end()) {
+        NameSet used = range;
+        used.insert(suffix_names.begin(), suffix_names.end());
+        name = get_unused_name(used, 0);
+    }
+    return push_binder(bound_name, name, sigma, range);
+}
+
+// The transitions of `substitute_rec(body, sigma, range)`, where `body` is the
+// subterm of a definition compiled at `pc`. The substitution is only carried
+// out for the suffixes of the prefixes that are taken, so unfolding a call
+// does not rebuild all alternatives of the body. Bound names are chosen
+// exactly as substitute_rec chooses them, so the next agents are the same as
+// well. Like substitute_rec, this extends sigma and range at the binders and
+// restores them.
+static void outgoing_code(
+    const PiProgram& program,
+    const Bytecode& code,
+    uint32_t pc,
+    Substitution& sigma,
+    NameSet& range,
+    const ExplorerOptions& options,
+    TransitionCache* cache,
+    std::vector<PiTransition>& result
+) {
+    auto value = [&](PiName name) {
+        auto it = sigma.find(name);
+        return it == sigma.end() ? name : it->second;
+    };
+
+    // SUM; the right alternatives are taken in this loop
+    while (code.instructions[pc].opcode == Opcode::SUM) {
+        outgoing_code(program, code, pc + 1, sigma, range, options, cache, result);
+        pc = code.instructions[pc].operands[0];
+    }
+
+    auto& operands = code.instructions[pc].operands;
+    switch (code.instructions[pc].opcode) {
+        case Opcode::ZERO:
+        case Opcode::SUM:
+            break;
+
+        // INPUT
+        case Opcode::INPUT: {
+            PiName channel = value(operands[0]);
+            auto change = bind_name(operands[1], code.names[pc], sigma, range);
+            auto suffix = substitute_rec(AgentPtr(operands[2]), sigma, range);
+            pop_binder(change, sigma, range);
+            outgoing_input(channel, change.name, suffix, options, result);
+            break;
+        }
+
+        // OUTPUT
+        case Opcode::OUTPUT:
+            result.push_back(PiTransition {
+                PiAction { ActionKind::FREE_OUTPUT, value(operands[0]), value(operands[1]) },
+                substitute_rec(AgentPtr(operands[2]), sigma, range)
+            });
+            break;
+
+        // TAU
+        case Opcode::TAU:
+            result.push_back(PiTransition {
+                PiAction { ActionKind::TAU, 0, 0 },
+                substitute_rec(AgentPtr(operands[0]), sigma, range)
+            });
+            break;
+
+        // RES, OPEN
+        case Opcode::NEW: {
+            auto change = bind_name(operands[0], code.names[pc], sigma, range);
+            std::vector<PiTransition> rec;
+            outgoing_code(program, code, pc + 1, sigma, range, options, cache, rec);
+            pop_binder(change, sigma, range);
+            remove_duplicates(rec);
+            outgoing_restriction(change.name, operands[1] != 0, rec, options, result);
+            break;
+        }
+
+        // MATCH
+        case Opcode::MATCH:
+            if (value(operands[0]) == value(operands[1])) {
+                outgoing_code(program, code, pc + 1, sigma, range, options, cache, result);
+            }
+            break;
+
+        // the transitions of parallel compositions and calls depend on their
+        // whole agent anyway
+        case Opcode::PAR:
+        case Opcode::CALL: {
+            auto rec = outgoing(program, substitute_rec(AgentPtr(operands[0]), sigma, range), options, cache);
+            result.insert(result.end(), rec.begin(), rec.end());
+            break;
+        }
+    }
+}
+
+std::vector<PiTransition> outgoing(
+    const PiProgram& program,
+    const AgentPtr& agent,
+    const ExplorerOptions& options,
+    TransitionCache* cache
+) {
+    // the transitions of a single output or tau prefix are cheaper to compute
+    // than to look up
+    bool cacheable = cache != nullptr &&
+        agent->kind != AgentKind::ZERO &&
+        agent->kind != AgentKind::OUTPUT_PREFIX &&
+        agent->kind != AgentKind::TAU_PREFIX;
+    if (cacheable) {
+        auto cached = cache->find(agent);
+        if (cached.has_value()) {
+            return std::move(*cached);
+        }
+    }
+
+    std::vector<PiTransition> result;
+
+    switch (agent->kind) {
+        case AgentKind::ZERO:
+            break;
+
+        // SUM
+        case AgentKind::SUMMATION: {
+            result = outgoing(program, agent->lhs, options, cache);
+            auto rhs = outgoing(program, agent->rhs, options, cache);
+            result.insert(result.end(), rhs.begin(), rhs.end());
+            break;
+        }
+
+        // INPUT
+        case AgentKind::INPUT_PREFIX:
+            outgoing_input(agent->name1, agent->name2, agent->lhs, options, result);
+            break;
+
+        // OUTPUT
+        case AgentKind::OUTPUT_PREFIX:
+            result.push_back(PiTransition {
+                PiAction { ActionKind::FREE_OUTPUT, agent->name1, agent->name2 },
+                agent->lhs
+            });
+            break;
+
+        // TAU
+        case AgentKind::TAU_PREFIX:
+            result.push_back(PiTransition { PiAction { ActionKind::TAU, 0, 0 }, agent->lhs });
+            break;
+
+        // PAR, COM, CLOSE
+        case AgentKind::PARALLEL_COMPOSITION:
+            if (options.counting && head_operand(agent->rhs) == agent->lhs) {
+                outgoing_copies(program, *agent, options, cache, result);
+                break;
+            }
+            outgoing_parallel_composition(
+                *agent,
+                outgoing(program, agent->lhs, options, cache),
+                outgoing(program, agent->rhs, options, cache),
+                result
+            );
+            break;
+
+        // RES, OPEN
+        case AgentKind::RESTRICTION:
+            outgoing_restriction(
+                agent->name1,
+                is_free_name(*agent->lhs, agent->name1),
+                outgoing(program, agent->lhs, options, cache),
+                options,
+                result
+            );
+            break;
+
+        // MATCH
+        case AgentKind::MATCH:
+            if (agent->name1 == agent->name2) {
+                result = outgoing(program, agent->lhs, options, cache);
+            }
+            break;
+
+        // IDE
+        case AgentKind::IDENTIFIER: {
+            if (agent->id < options.compiled.size()) {
+                options.compiled[agent->id](program, agent->args, options, cache, result);
+                break;
+            }
+
+            // the converter checks that every call has def.arity arguments
+            auto& def = program.definitions[agent->id];
+            Substitution sigma;
+            NameSet range;
+            for (PiName i = 0; i < agent->args.size(); i++) {
+                sigma[i] = agent->args[i];
+                range.insert(i);
+            }
+            range.insert(agent->args.begin(), agent->args.end());
+            outgoing_code(program, def.code, 0, sigma, range, options, cache, result);
+            break;
+        }
+    }
+
+    remove_duplicates(result);
+    if (cacheable) {
+        cache->insert(agent, result);
+    }
+    return result;
+}
+
+// The parallel components of a state: the operands of the parallel
+// compositions and restrictions at the top of its agent, from left to right.
+struct Components final {
+    struct Scope {
+        PiName name;
+        size_t begin; // the components below the restriction
+        size_t end;
+    };
+
+    std::vector<AgentPtr> agents;
+    std::vector<std::vector<size_t>> scopes; // the restrictions around every component, outermost first
+    std::vector<Scope> restrictions;
+};
+
+static void collect_components(const AgentPtr& agent, std::vector<size_t>& scopes, Components& components) {
+    switch (agent->kind) {
+        case AgentKind::PARALLEL_COMPOSITION:
+            collect_components(agent->lhs, scopes, components);
+            collect_components(agent->rhs, scopes, components);
+            break;
+
+        case AgentKind::RESTRICTION: {
+            size_t scope = components.restrictions.size();
+            components.restrictions.push_back(Components::Scope { agent->name1, components.agents.size(), 0 });
+            scopes.push_back(scope);
+            collect_components(agent->lhs, scopes, components);
+            scopes.pop_back();
+            components.restrictions[scope].end = components.agents.size();
+            break;
+        }
+
+        default:
+            components.agents.push_back(agent);
+            components.scopes.push_back(scopes);
+            break;
+    }
+}
+
+// the innermost restriction of `name` around the component, if any
+static std::optional<size_t> find_scope(const Components& components, size_t component, PiName name) {
+    auto& scopes = components.scopes[component];
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        if (components.restrictions[*it].name == name) {
+            return *it;
+        }
+    }
+    return std::nullopt;
+}
+
+// `outgoing(agent)` as if the components that are not selected had no
+// transitions; `next` is the index of the next component
+static std::vector<PiTransition> outgoing_components(
+    const AgentPtr& agent,
+    const std::vector<std::vector<PiTransition>>& transitions,
+    const std::vector<bool>& selected,
+    const ExplorerOptions& options,
+    size_t& next
+) {
+    std::vector<PiTransition> result;
+
+    switch (agent->kind) {
+        case AgentKind::PARALLEL_COMPOSITION: {
+            auto rec1 = outgoing_components(agent->lhs, transitions, selected, options, next);
+            auto rec2 = outgoing_components(agent->rhs, transitions, selected, options, next);
+            outgoing_parallel_composition(*agent, rec1, rec2, result);
+            break;
+        }
+
+        case AgentKind::RESTRICTION:
+            outgoing_restriction(
+                agent->name1,
+                is_free_name(*agent->lhs, agent->name1),
+                outgoing_components(agent->lhs, transitions, selected, options, next),
+                options,
+                result
+            );
+            break;
+
+        default:
+            if (selected[next]) {
+                result = transitions[next];
+            }
+            next++;
+            break;
+    }
+
+    remove_duplicates(result);
+    return result;
+}
+
+// An ample set: the transitions of a set of components whose inputs and
+// outputs are all on restricted channels, closed under the other components
+// in the scope of those channels that have them free. These components can
+// only synchronize with each other, so their transitions are tau steps that
+// are independent of the rest, which cannot take part in them later either.
+// The smallest such set with transitions is taken; returns nothing if there
+// is none besides all components.
+static std::optional<std::vector<PiTransition>> ample_transitions(
+    const PiProgram& program,
+    const AgentPtr& agent,
+    const ExplorerOptions& options,
+    TransitionCache* cache
+) {
+    Components components;
+    std::vector<size_t> scopes;
+    collect_components(agent, scopes, components);
+    size_t size = components.agents.size();
+    if (size < 2) {
+        return std::nullopt;
+    }
+
+    std::vector<std::vector<PiTransition>> transitions;
+    std::vector<std::vector<PiName>> channels(size);
+    for (size_t component = 0; component < size; component++) {
+        transitions.push_back(outgoing(program, components.agents[component], options, cache));
+        auto& list = channels[component];
+        for (auto& transition : transitions.back()) {
+            auto& action = transition.action;
+            if (action.kind != ActionKind::TAU &&
+                std::find(list.begin(), list.end(), action.channel) == list.end()) {
+                list.push_back(action.channel);
+            }
+        }
+    }
+
+    // nothing if one of the components can take a visible action
+    auto closure = [&](size_t seed) -> std::optional<std::vector<bool>> {
+        std::vector<bool> selected(size, false);
+        std::vector<size_t> todo { seed };
+        selected[seed] = true;
+        while (!todo.empty()) {
+            size_t component = todo.back();
+            todo.pop_back();
+            for (PiName channel : channels[component]) {
+                auto scope = find_scope(components, component, channel);
+                if (!scope.has_value()) {
+                    return std::nullopt;
+                }
+                auto& restriction = components.restrictions[*scope];
+                for (size_t other = restriction.begin; other < restriction.end; other++) {
+                    if (!selected[other] &&
+                        is_free_name(*components.agents[other], channel) &&
+                        find_scope(components, other, channel) == scope) {
+                        selected[other] = true;
+                        todo.push_back(other);
+                    }
+                }
+            }
+        }
+        return selected;
+    };
+
+    std::vector<std::pair<size_t, std::vector<bool>>> candidates;
+    for (size_t seed = 0; seed < size; seed++) {
+        auto selected = closure(seed);
+        if (!selected.has_value()) {
+            continue;
+        }
+        size_t count = std::count(selected->begin(), selected->end(), true);
+        if (count < size) {
+            candidates.emplace_back(count, std::move(*selected));
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](auto& lhs, auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    for (auto& [count, selected] : candidates) {
+        size_t next = 0;
+        auto result = outgoing_components(agent, transitions, selected, options, next);
+        if (!result.empty()) {
+            return result;
+        }
+    }
+    return std::nullopt;
+}
+
+// counts the parallel components at the top of the state, and the copies
+// among them that `outgoing_copies` leaves out
+static void count_components(const AgentPtr& agent, CountingStatistics& statistics) {
+    switch (agent->kind) {
+        case AgentKind::PARALLEL_COMPOSITION:
+            if (head_operand(agent->rhs) == agent->lhs) {
+                statistics.copies++;
+            }
+            count_components(agent->lhs, statistics);
+            count_components(agent->rhs, statistics);
+            break;
+
+        case AgentKind::RESTRICTION:
+            count_components(agent->lhs, statistics);
+            break;
+
+        default:
+            statistics.components++;
+            break;
+    }
+}
+
+// the state, after the rewrites selected in the options
+static AgentPtr canonical_state(const AgentPtr& next_agent, const ExplorerOptions& options) {
+    auto agent = options.congruence ? normalize_congruence(next_agent) : next_agent;
+    if (options.alpha_canonical) {
+        agent = canonical_names(agent);
+        if (options.congruence) {
+            // sort the operands again by their new names
+            agent = normalize_congruence(agent);
+        }
+    }
+    return agent;
+}
+
+struct LtsEdgeHash {
+    size_t operator()(const std::pair<PiAction, size_t>& edge) const {
+        size_t hash = static_cast<size_t>(edge.first.kind);
+        hash = hash * 31 + edge.first.channel;
+        hash = hash * 31 + edge.first.data;
+        return hash * 31 + edge.second;
+    }
+};
+
+// The next agents of different transitions can be the same state up to the
+// rewrites of canonical_state, as those of copies of a component are, so the
+// transitions to the same state with the same action are taken once.
+static void remove_duplicate_edges(std::vector<std::pair<PiAction, size_t>>& edges) {
+    if (edges.size() < 2) {
+        return;
+    }
+
+    std::unordered_set<std::pair<PiAction, size_t>, LtsEdgeHash> seen;
+    std::vector<std::pair<PiAction, size_t>> result;
+    result.reserve(edges.size());
+    for (auto& edge : edges) {
+        if (seen.insert(edge).second) {
+            result.push_back(edge);
+        }
+    }
+    edges = std::move(result);
+}
+
+// The transitions of `agent` to the numbers given by `get_state`. With
+// partial order reduction, the ample set is only taken if none of its
+// transitions lead to a state for which `may_be_explored` holds; otherwise a
+// cycle of ample sets could postpone the other transitions forever. Every
+// cycle has a state whose successor on the cycle was explored before it, so
+// that state is fully expanded.
+template <typename GetState, typename MayBeExplored>
+static std::vector<std::pair<PiAction, size_t>> explore_transitions(
+    const PiProgram& program,
+    const AgentPtr& agent,
+    const ExplorerOptions& options,
+    TransitionCache* cache,
+    GetState&& get_state,
+    MayBeExplored&& may_be_explored
+) {
+    std::vector<std::pair<PiAction, size_t>> result;
+    if (options.partial_order) {
+        auto ample = ample_transitions(program, agent, options, cache);
+        if (ample.has_value()) {
+            bool closes_cycle = false;
+            for (auto& transition : *ample) {
+                size_t to = get_state(transition.next_agent);
+                closes_cycle = closes_cycle || may_be_explored(to);
+                result.emplace_back(transition.action, to);
+            }
+            if (!closes_cycle) {
+                remove_duplicate_edges(result);
+                return result;
+            }
+            result.clear();
+        }
+    }
+
+    for (auto& transition : outgoing(program, agent, options, cache)) {
+        result.emplace_back(transition.action, get_state(transition.next_agent));
+    }
+    remove_duplicate_edges(result);
+    return result;
+}
+
+static Lts explore_sequential(
+    const PiProgram& program,
+    const ExplorerOptions& options,
+    TransitionCache* cache
+) {
+    Lts lts;
+    std::unordered_map<AgentPtr, size_t, AgentPtrHash, AgentPtrEqual> states;
+    std::deque<AgentPtr> queue;
+
+    auto get_state = [&](const AgentPtr& next_agent) {
+        auto agent = canonical_state(next_agent, options);
+        auto [it, inserted] = states.emplace(agent, states.size());
+        if (inserted) {
+            queue.push_back(agent);
+        }
+        return it->second;
+    };
+
+    get_state(program.initial_agent);
+    while (!queue.empty()) {
+        auto agent = std::move(queue.front());
+        queue.pop_front();
+        size_t from = states.find(agent)->second;
+        if (options.counting) {
+            count_components(agent, lts.counting_statistics);
+        }
+
+        // the states are explored in the order of their numbers
+        auto transitions = explore_transitions(program, agent, options, cache, get_state, [&](size_t to) {
+            return to <= from;
+        });
+        for (auto& [action, to] : transitions) {
+            lts.transitions.push_back(LtsTransition { from, action, to });
+        }
+    }
+
+    lts.num_states = states.size();
+    return lts;
+}
+
+// The visited set of the parallel explorer. Every shard has its own lock, so
+// threads only wait for each other when their states hash to the same shard.
+class StateSet final {
+public:
+    // returns (state number, whether the state is new)
+    std::pair<size_t, bool> insert(const AgentPtr& agent) {
+        auto& shard = shards[agent->hash % NUM_SHARDS];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.states.find(agent);
+        if (it != shard.states.end()) {
+            return { it->second, false };
+        }
+        size_t number = counter.fetch_add(1);
+        shard.states.emplace(agent, number);
+        return { number, true };
+    }
+
+    size_t size() const {
+        return counter.load();
+    }
+
+private:
+    static constexpr size_t NUM_SHARDS = 256;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<AgentPtr, size_t, AgentPtrHash, AgentPtrEqual> states;
+    };
+
+    std::array<Shard, NUM_SHARDS> shards;
+    std::atomic<size_t> counter { 0 };
+};
+
+struct ExplorerTask {
+    AgentPtr agent;
+    size_t number;
+};
+
+// The owner takes tasks from the back, other threads steal from the front,
+// where the oldest tasks are.
+class TaskDeque final {
+public:
+    void push(ExplorerTask task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+
+    std::optional<ExplorerTask> pop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return std::nullopt;
+        }
+        auto task = std::move(tasks.back());
+        tasks.pop_back();
+        return task;
+    }
+
+    std::optional<ExplorerTask> steal() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return std::nullopt;
+        }
+        auto task = std::move(tasks.front());
+        tasks.pop_front();
+        return task;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<ExplorerTask> tasks;
+};
+
+// the outgoing transitions of one state, to numbers in order of discovery
+struct ExploredState {
+    size_t number;
+    std::vector<std::pair<PiAction, size_t>> transitions;
+};
+
+static Lts explore_parallel(
+    const PiProgram& program,
+    const ExplorerOptions& options,
+    TransitionCache* cache
+) {
+    StateSet states;
+    std::vector<TaskDeque> deques(options.threads);
+    std::vector<std::vector<ExploredState>> explored(options.threads);
+    std::vector<CountingStatistics> counting_statistics(options.threads);
+
+    // the number of discovered states that have not been explored yet
+    std::atomic<size_t> pending { 1 };
+
+    auto initial = canonical_state(program.initial_agent, options);
+    deques[0].push(ExplorerTask { initial, states.insert(initial).first });
+
+    auto work = [&](size_t thread) {
+        while (pending.load() > 0) {
+            auto task = deques[thread].pop();
+            for (size_t i = 1; !task.has_value() && i < options.threads; i++) {
+                task = deques[(thread + i) % options.threads].steal();
+            }
+            if (!task.has_value()) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            auto get_state = [&](const AgentPtr& next_agent) {
+                auto agent = canonical_state(next_agent, options);
+                auto [number, inserted] = states.insert(agent);
+                if (inserted) {
+                    pending.fetch_add(1);
+                    deques[thread].push(ExplorerTask { std::move(agent), number });
+                }
+                return number;
+            };
+            if (options.counting) {
+                count_components(task->agent, counting_statistics[thread]);
+            }
+
+            // states discovered later than this one are taken up later too
+            size_t discovered = states.size();
+            explored[thread].push_back(ExploredState {
+                task->number,
+                explore_transitions(program, task->agent, options, cache, get_state, [&](size_t to) {
+                    return to < discovered;
+                })
+            });
+            pending.fetch_sub(1);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t thread = 1; thread < options.threads; thread++) {
+        threads.emplace_back(work, thread);
+    }
+    work(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<ExploredState*> by_number(states.size());
+    for (auto& list : explored) {
+        for (auto& state : list) {
+            by_number[state.number] = &state;
+        }
+    }
+
+    // renumber the states in breadth-first order, which gives exactly the
+    // LTS of the sequential explorer
+    Lts lts;
+    std::vector<std::optional<size_t>> renumbered(states.size());
+    std::vector<size_t> order { 0 };
+    renumbered[0] = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        for (auto& [action, to] : by_number[order[i]]->transitions) {
+            if (!renumbered[to].has_value()) {
+                renumbered[to] = order.size();
+                order.push_back(to);
+            }
+            lts.transitions.push_back(LtsTransition { i, action, *renumbered[to] });
+        }
+    }
+
+    lts.num_states = order.size();
+    for (auto& statistics : counting_statistics) {
+        lts.counting_statistics.components += statistics.components;
+        lts.counting_statistics.copies += statistics.copies;
+    }
+    return lts;
+}
+
+Lts explore(const PiProgram& program, const ExplorerOptions& options) {
+    std::optional<TransitionCache> cache;
+    if (options.cache_size > 0) {
+        cache.emplace(options.cache_size);
+    }
+    auto cache_ptr = cache.has_value() ? &*cache : nullptr;
+
+    auto lts = options.threads > 1
+        ? explore_parallel(program, options, cache_ptr)
+        : explore_sequential(program, options, cache_ptr);
+    if (cache.has_value()) {
+        lts.cache_statistics = cache->get_statistics();
+    }
+    return lts;
+}
+
+void write_aut(OutputSink& output, const Lts& lts) {
+    output += "des (0,";
+    output.append_number(lts.transitions.size());
+    output += ',';
+    output.append_number(lts.num_states);
+    output += ")\n";
+    for (auto& transition : lts.transitions) {
+        output += '(';
+        output.append_number(transition.from);
+        output += ",\"";
+        append_action(output, transition.action);
+        output += "\",";
+        output.append_number(transition.to);
+        output += ")\n";
+    }
+}
+
+} // end namespace picalc
@@ -0,0 +1,103 @@
+#ifndef PICALC_EXPLORER_H
+#define PICALC_EXPLORER_H
+
+#include "agent.hpp"
+#include "outputsink.hpp"
+
+#include <vector>
+
+namespace picalc {
+
+enum class ActionKind {
+    FREE_INPUT,
+    BOUND_INPUT,
+    FREE_OUTPUT,
+    BOUND_OUTPUT,
+    TAU
+};
+
+struct PiAction final {
+    ActionKind kind;
+    PiName channel;
+    PiName data;
+
+    bool operator==(const PiAction& rhs) const {
+        return kind == rhs.kind && channel == rhs.channel && data == rhs.data;
+    }
+};
+
+struct PiTransition final {
+    PiAction action;
+    AgentPtr next_agent;
+};
+
+struct ExplorerOptions;
+class TransitionCache;
+
+// the transitions of `identifier(id, args)` for one definition, as generated
+// by --target=cpp
+using CompiledOutgoing = void (*)(
+    const PiProgram& program,
+    const std::vector<PiName>& args,
+    const ExplorerOptions& options,
+    TransitionCache* cache,
+    std::vector<PiTransition>& result
+);
+
+struct ExplorerOptions {
+    PiName names_bound; // pi_names = { name': PiName | name' < names_bound }
+    bool congruence = false; // identify states modulo structural congruence
+    bool alpha_canonical = false; // identify alpha-equivalent states
+    bool partial_order = false; // only take the transitions of an ample set of components
+    bool counting = false; // generate the transitions of identical adjacent components once
+    size_t threads = 1; // the number of threads used by `explore`
+    size_t cache_size = 0; // the number of agents in the transition cache
+    std::vector<CompiledOutgoing> compiled; // per definition, if the model is compiled
+};
+
+// the late semantics of `outgoing` in mcrl2/picalc.mcrl2; the transitions of
+// subterms are looked up in and added to the cache, if one is given
+std::vector<PiTransition> outgoing(
+    const PiProgram& program,
+    const AgentPtr& agent,
+    const ExplorerOptions& options,
+    TransitionCache* cache = nullptr
+);
+
+struct LtsTransition final {
+    size_t from;
+    PiAction action;
+    size_t to;
+};
+
+struct CacheStatistics {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+};
+
+struct CountingStatistics {
+    size_t components = 0; // summed over the explored states
+    size_t copies = 0; // the components whose transitions were left out
+};
+
+struct Lts final {
+    size_t num_states = 0; // the initial state is always 0
+    std::vector<LtsTransition> transitions;
+    CacheStatistics cache_statistics;
+    CountingStatistics counting_statistics;
+};
+
+// breadth-first generation of the state space of `PiInterpreter`; with more
+// than one thread, the states are numbered afterwards as if they were
+// generated sequentially, so the LTS does not depend on the number of threads
+// (except for the ample sets of partial order reduction, whose cycle proviso
+// depends on the order in which states are discovered)
+Lts explore(const PiProgram& program, const ExplorerOptions& options);
+
+// writes the LTS in the Aldebaran (.aut) format
+void write_aut(OutputSink& output, const Lts& lts);
+
+} // end namespace picalc
+
+#endif
@@ -1,8 +1,12 @@
 #include "lexer.hpp"
 
-#include <cassert>
+#include <cstring>
 #include <utility>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace picalc {
 
 std::ostream& operator<<(std::ostream& os, const TokenType& token) {
@@ -47,131 +51,292 @@ std::ostream& operator<<(std::ostream& os, const TokenType& token) {
     return os;
 }
 
-Expected<std::vector<Token>> tokenize(const std::string& input) {
-    std::vector<Token> result;
-    uint32_t line = 0;
-    uint32_t character = 0;
-    uint32_t currentLine = 0;
-    uint32_t currentCharacter = 0;
-    TokenType currentTokenType = TokenType::IDENTIFIER;
-    std::string current;
-    std::vector<Error> errors;
+namespace {
 
-    auto endToken = [&]() {
-        if (current.size() == 0) {
-            return;
-        }
+enum class CharClass : uint8_t {
+    UNKNOWN,
+    SPACE, // space, tab or carriage return
+    NEWLINE,
+    COMMENT, // % starts a comment until the end of the line
+    DIGIT,
+    LETTER, // or _
+    SYMBOL // a token of its own
+};
 
-        SourceLocation loc(currentLine, currentCharacter);
-        if (current == "agent") {
-            result.push_back(Token(TokenType::AGENT, "", loc));
-        } else if (current == "tau") {
-            result.push_back(Token(TokenType::TAU, "", loc));
-        } else if (current[0] >= '0' && current[0] <= '9') {
-            result.push_back(Token(TokenType::NUMBER, std::move(current), loc));
-        } else {
-            result.push_back(Token(TokenType::IDENTIFIER, std::move(current), loc));
-        }
-        current = "";
+struct CharTable final {
+    CharClass classes[256];
+    TokenType symbols[256]; // of the SYMBOL characters
+};
+
+constexpr CharTable make_char_table() {
+    CharTable table {};
+    table.classes[static_cast<unsigned char>(' ')] = CharClass::SPACE;
+    table.classes[static_cast<unsigned char>('\t')] = CharClass::SPACE;
+    table.classes[static_cast<unsigned char>('\r')] = CharClass::SPACE;
+    table.classes[static_cast<unsigned char>('\n')] = CharClass::NEWLINE;
+    table.classes[static_cast<unsigned char>('%')] = CharClass::COMMENT;
+    for (char c = '0'; c <= '9'; c++) {
+        table.classes[static_cast<unsigned char>(c)] = CharClass::DIGIT;
+    }
+    for (char c = 'a'; c <= 'z'; c++) {
+        table.classes[static_cast<unsigned char>(c)] = CharClass::LETTER;
+        table.classes[static_cast<unsigned char>(c - 'a' + 'A')] = CharClass::LETTER;
+    }
+    table.classes[static_cast<unsigned char>('_')] = CharClass::LETTER;
+
+    const std::pair<char, TokenType> symbols[] = {
+        { ';', TokenType::SEMICOLON },
+        { '(', TokenType::OPENING_PAREN },
+        { ')', TokenType::CLOSING_PAREN },
+        { '[', TokenType::OPENING_BRACKET },
+        { ']', TokenType::CLOSING_BRACKET },
+        { '<', TokenType::LESS_THAN },
+        { '>', TokenType::GREATER_THAN },
+        { ',', TokenType::COMMA },
+        { '\'', TokenType::APOSTROPHE },
+        { '=', TokenType::EQUALS },
+        { '.', TokenType::PERIOD },
+        { '+', TokenType::PLUS },
+        { '|', TokenType::PIPE },
+        { '^', TokenType::CIRCONFLEX },
+        { '~', TokenType::TILDE }
     };
+    for (auto& [c, token_type] : symbols) {
+        table.classes[static_cast<unsigned char>(c)] = CharClass::SYMBOL;
+        table.symbols[static_cast<unsigned char>(c)] = token_type;
+    }
+    return table;
+}
+
+constexpr CharTable char_table = make_char_table();
+
+CharClass get_class(char c) {
+    return char_table.classes[static_cast<unsigned char>(c)];
+}
+
+bool is_word(char c) {
+    auto char_class = get_class(c);
+    return char_class == CharClass::LETTER || char_class == CharClass::DIGIT;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+// Runs of word and space characters are scanned one vector at a time: the
+// bytes are compared against the character ranges and the first byte
+// outside the run is found in the movemask with a count of trailing zeros.
+// Bytes of 0x80 and above are negative as signed chars, so they fall
+// outside every range.
+#if defined(__AVX2__)
+using Vector = __m256i;
+constexpr ptrdiff_t vector_size = 32;
+constexpr uint32_t all_lanes = 0xFFFFFFFF;
+
+Vector load(const char* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+Vector splat(char c) {
+    return _mm256_set1_epi8(c);
+}
+
+Vector equals(Vector a, Vector b) {
+    return _mm256_cmpeq_epi8(a, b);
+}
+
+Vector greater(Vector a, Vector b) {
+    return _mm256_cmpgt_epi8(a, b);
+}
+
+Vector either(Vector a, Vector b) {
+    return _mm256_or_si256(a, b);
+}
+
+Vector both(Vector a, Vector b) {
+    return _mm256_and_si256(a, b);
+}
+
+uint32_t get_mask(Vector v) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+}
+#else
+using Vector = __m128i;
+constexpr ptrdiff_t vector_size = 16;
+constexpr uint32_t all_lanes = 0xFFFF;
+
+Vector load(const char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+Vector splat(char c) {
+    return _mm_set1_epi8(c);
+}
+
+Vector equals(Vector a, Vector b) {
+    return _mm_cmpeq_epi8(a, b);
+}
+
+Vector greater(Vector a, Vector b) {
+    return _mm_cmpgt_epi8(a, b);
+}
+
+Vector either(Vector a, Vector b) {
+    return _mm_or_si128(a, b);
+}
+
+Vector both(Vector a, Vector b) {
+    return _mm_and_si128(a, b);
+}
+
+uint32_t get_mask(Vector v) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(v));
+}
+#endif
+
+// lo <= c <= hi
+Vector in_range(Vector c, char lo, char hi) {
+    return both(greater(c, splat(lo - 1)), greater(splat(hi + 1), c));
+}
+
+uint32_t word_mask(Vector c) {
+    auto lower = either(c, splat(0x20)); // folds A-Z onto a-z
+    return get_mask(either(
+        either(in_range(lower, 'a', 'z'), in_range(c, '0', '9')),
+        equals(c, splat('_'))
+    ));
+}
+
+uint32_t space_mask(Vector c) {
+    return get_mask(either(
+        either(equals(c, splat(' ')), equals(c, splat('\t'))),
+        equals(c, splat('\r'))
+    ));
+}
 
-    auto put = [&](char c) {
-        if (current.size() == 0) {
-            currentLine = line;
-            currentCharacter = character;
+#endif
+
+// the end of the run of letters and digits that starts at p
+const char* skip_word(const char* p, const char* end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (end - p >= vector_size) {
+        uint32_t stop = ~word_mask(load(p)) & all_lanes;
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
         }
-        current.push_back(c);
-        character++;
-    };
+        p += vector_size;
+    }
+#endif
+    while (p != end && is_word(*p)) {
+        p++;
+    }
+    return p;
+}
 
-    auto addSymbol = [&](TokenType tokenType) {
-        endToken();
-        currentLine = line;
-        currentCharacter = character;
-        character++;
-        SourceLocation loc(currentLine, currentCharacter);
-        result.push_back(Token(tokenType, "", loc));
-        assert(current.size() == 0);
+// the end of the run of spaces that starts at p
+const char* skip_spaces(const char* p, const char* end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (end - p >= vector_size) {
+        uint32_t stop = ~space_mask(load(p)) & all_lanes;
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+        p += vector_size;
+    }
+#endif
+    while (p != end && get_class(*p) == CharClass::SPACE) {
+        p++;
+    }
+    return p;
+}
+
+// the newline that ends the comment at p, or the end of the input
+const char* skip_comment(const char* p, const char* end) {
+    // memchr is vectorized by the C library
+    auto newline = std::memchr(p, '\n', end - p);
+    return newline != nullptr ? static_cast<const char*>(newline) : end;
+}
+
+} // end anonymous namespace
+
+Expected<ArenaVector<Token>> tokenize(std::string_view input, Arena& arena, SymbolTable& symbols) {
+    ArenaVector<Token> result(arena);
+    std::vector<Error> errors;
+
+    const char* p = input.data();
+    const char* end = p + input.size();
+    uint32_t line = 0;
+    const char* line_start = p;
+
+    auto get_loc = [&](const char* q) {
+        return SourceLocation(line, static_cast<uint32_t>(q - line_start));
     };
 
-    for (size_t i = 0; i < input.size(); i++) {
-        char c = input[i];
-
-        if (c == ' ' || c == '\t' || c == '\r') {
-            endToken();
-            character++;
-        } else if (c == '\n') {
-            endToken();
-            line++;
-            character = 0;
-        } else if (c == '%') {
-            endToken();
-            character++;
-            while (i < input.size() && input[i] != '\n') {
-                i++;
+    while (p != end) {
+        switch (get_class(*p)) {
+            case CharClass::SPACE:
+                p = skip_spaces(p + 1, end);
+                break;
+
+            case CharClass::NEWLINE:
+                p++;
+                line++;
+                line_start = p;
+                break;
+
+            case CharClass::COMMENT:
+                p = skip_comment(p + 1, end);
+                break;
+
+            case CharClass::SYMBOL:
+                result.push_back(Token(char_table.symbols[static_cast<unsigned char>(*p)], "", get_loc(p)));
+                p++;
+                break;
+
+            case CharClass::DIGIT: {
+                auto last = skip_word(p + 1, end);
+                for (auto q = p + 1; q != last; q++) {
+                    if (get_class(*q) == CharClass::LETTER) {
+                        errors.push_back(Error(
+                            ErrorType::SYNTAX,
+                            get_loc(q),
+                            "unexpected word characters in the middle of a number"
+                        ));
+                    }
+                }
+                result.push_back(Token(TokenType::NUMBER, std::string_view(p, last - p), get_loc(p)));
+                p = last;
+                break;
             }
-        } else if (c == ';') {
-            addSymbol(TokenType::SEMICOLON);
-        } else if (c == '(') {
-            addSymbol(TokenType::OPENING_PAREN);
-        } else if (c == ')') {
-            addSymbol(TokenType::CLOSING_PAREN);
-        } else if (c == '[') {
-            addSymbol(TokenType::OPENING_BRACKET);
-        } else if (c == ']') {
-            addSymbol(TokenType::CLOSING_BRACKET);
-        } else if (c == '<') {
-            addSymbol(TokenType::LESS_THAN);
-        } else if (c == '>') {
-            addSymbol(TokenType::GREATER_THAN);
-        } else if (c == ',') {
-            addSymbol(TokenType::COMMA);
-        } else if (c == '\'') {
-            addSymbol(TokenType::APOSTROPHE);
-        } else if (c == '=') {
-            addSymbol(TokenType::EQUALS);
-        } else if (c == '.') {
-            addSymbol(TokenType::PERIOD);
-        } else if (c == '+') {
-            addSymbol(TokenType::PLUS);
-        } else if (c == '|') {
-            addSymbol(TokenType::PIPE);
-        } else if (c == '^') {
-            addSymbol(TokenType::CIRCONFLEX);
-        } else if (c == '~') {
-            addSymbol(TokenType::TILDE);
-        } else if (c >= '0' && c <= '9') {
-            put(c);
-        } else if (
-            (c >= 'a' && c <= 'z') ||
-            (c >= 'A' && c <= 'Z') ||
-            c == '_'
-        ) {
-            if (current.size() > 0 && current[0] >= '0' && current[0] <= '9') {
+
+            case CharClass::LETTER: {
+                auto last = skip_word(p + 1, end);
+                std::string_view word(p, last - p);
+                if (word == "agent") {
+                    result.push_back(Token(TokenType::AGENT, "", get_loc(p)));
+                } else if (word == "tau") {
+                    result.push_back(Token(TokenType::TAU, "", get_loc(p)));
+                } else {
+                    auto id = symbols.intern(word);
+                    result.push_back(Token(TokenType::IDENTIFIER, id.value, get_loc(p), id.symbol));
+                }
+                p = last;
+                break;
+            }
+
+            case CharClass::UNKNOWN:
                 errors.push_back(Error(
                     ErrorType::SYNTAX,
-                    SourceLocation(line, character),
-                    "unexpected word characters in the middle of a number"
+                    get_loc(p),
+                    "unknown character"
                 ));
-            } else {
-                put(c);
-            }
-        } else {
-            character++;
-            errors.push_back(Error(
-                ErrorType::SYNTAX,
-                SourceLocation(line, character),
-                "unknown character"
-            ));
+                p++;
+                break;
         }
     }
 
-    endToken();
-
     if (errors.size() == 0) {
-        return Expected<std::vector<Token>>(std::move(result));
+        return Expected<ArenaVector<Token>>(std::move(result));
     } else {
-        return Expected<std::vector<Token>>(std::move(errors));
+        return Expected<ArenaVector<Token>>(std::move(errors));
     }
 }
 
@@ -1,10 +1,13 @@
 #ifndef PICALC_LEXER_H
 #define PICALC_LEXER_H
 
+#include "arena.hpp"
 #include "core.hpp"
+#include "symbols.hpp"
 
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace picalc {
@@ -34,19 +37,28 @@ enum class TokenType {
 std::ostream& operator<<(std::ostream& os, const TokenType& token);
 
 struct Token final {
-    explicit Token(TokenType token_type, std::string value, SourceLocation loc) :
+    explicit Token(
+        TokenType token_type,
+        std::string_view value,
+        SourceLocation loc,
+        Symbol symbol = 0
+    ) :
         token_type(token_type),
-        value(std::move(value)),
+        symbol(symbol),
+        value(value),
         loc(loc) {}
 
     // std::string to_string() const; // TODO
 
     TokenType token_type;
-    std::string value;
+    Symbol symbol; // of an identifier
+    std::string_view value; // in the input
     SourceLocation loc;
 };
 
-Expected<std::vector<Token>> tokenize(const std::string& input);
+// interns the identifiers in `symbols`; the tokens and the symbols are views
+// into `input`, which is not copied
+Expected<ArenaVector<Token>> tokenize(std::string_view input, Arena& arena, SymbolTable& symbols);
 
 } // end namespace picalc
 
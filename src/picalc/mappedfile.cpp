@@ -0,0 +1,65 @@
+#include "mappedfile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace picalc {
+
+Expected<MappedFile> MappedFile::open(const std::string& path) {
+    auto error = [&](const std::string& message) {
+        return Expected<MappedFile>(Error {
+            ErrorType::CLI,
+            SourceLocation(0, 0),
+            message + " `" + path + "`"
+        });
+    };
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return error("Could not open input file");
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        return error("Could not read input file");
+    }
+
+    // mmap rejects a length of zero
+    size_t size = status.st_size;
+    if (size == 0) {
+        close(fd);
+        return MappedFile(nullptr, 0);
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) {
+        return error("Could not map input file");
+    }
+
+    // the lexer reads the input once from front to back
+    madvise(data, size, MADV_SEQUENTIAL);
+    return MappedFile(static_cast<const char*>(data), size);
+}
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept : data(rhs.data), size(rhs.size) {
+    rhs.data = nullptr;
+    rhs.size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept {
+    std::swap(data, rhs.data);
+    std::swap(size, rhs.size);
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+} // end namespace picalc
@@ -0,0 +1,41 @@
+#ifndef PICALC_MAPPEDFILE_H
+#define PICALC_MAPPEDFILE_H
+
+#include "core.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace picalc {
+
+// A read-only memory mapping of the input file. The tokens and the symbols
+// are views into the mapping, so it must outlive the module.
+class MappedFile final {
+public:
+    static Expected<MappedFile> open(const std::string& path);
+
+    MappedFile(MappedFile&& rhs) noexcept;
+
+    MappedFile& operator=(MappedFile&& rhs) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    std::string_view contents() const {
+        return std::string_view(data, size);
+    }
+
+private:
+    MappedFile(const char* data, size_t size) : data(data), size(size) {}
+
+    const char* data;
+    size_t size;
+};
+
+} // end namespace picalc
+
+#endif
@@ -1,148 +1,215 @@
 #include "mcrl2converter.hpp"
 
+#include <algorithm>
+
 namespace picalc {
 
 static void add_indentation(MCRL2ConverterState& state) {
+    if (state.indentation_string.empty()) return;
     for (int i = 0; i < state.indentation_counter; i++) {
         state.output += state.indentation_string;
     }
 }
 
+// starts a new line at the current indentation; a compact term stays on one
+// line, with `compact_text` in place of the line break
+static void add_line_break(MCRL2ConverterState& state, const char* compact_text = "") {
+    if (state.compact) {
+        state.output += compact_text;
+        return;
+    }
+    state.output += '\n';
+    add_indentation(state);
+}
+
 static std::optional<int> get_bound_name(
     const Identifier& id,
     SourceLocation loc,
     MCRL2ConverterState& state
 ) {
-    auto it = state.name_map.find(id);
-    if (it == state.name_map.end()) {
+    auto& scopes = state.name_map[id.symbol];
+    if (scopes.empty()) {
         state.errors.push_back(Error {
             ErrorType::IDENTIFIER,
             loc,
-            std::string("Unbound name `") + id.value + "`"
+            "Unbound name `" + std::string(id.value) + "`"
         });
         return std::nullopt;
     }
-    return it->second;
+    return scopes.back();
 }
 
-// returns (new name number, old name number)
-static std::pair<int, std::optional<int>> add_bound_name(
-    const Identifier& id,
-    MCRL2ConverterState& state
-) {
+// returns the new name number
+static int add_bound_name(const Identifier& id, MCRL2ConverterState& state) {
     int new_value = state.name_counter++;
-    auto it = state.name_map.find(id);
-    std::optional<int> old_value;
-    if (it != state.name_map.end()) {
-        old_value = it->second;
-    } else {
-        old_value = std::nullopt;
-    }
-    state.name_map[id] = new_value;
-
-    return {new_value, old_value};
+    state.name_map[id.symbol].push_back(new_value);
+    return new_value;
 }
 
-static void remove_bound_name(
-    const Identifier& id,
-    std::pair<int, std::optional<int>> old,
-    MCRL2ConverterState& state
-) {
-    if (old.second.has_value()) {
-        state.name_map[id] = old.second.value();
-    } else {
-        state.name_map.erase(id);
+static void remove_bound_name(Symbol symbol, MCRL2ConverterState& state) {
+    state.name_map[symbol].pop_back();
+    if (!state.unique_names) {
+        state.name_counter--;
     }
-    state.name_counter--;
 }
 
-static void convert_proc_to_mcrl2(const Proc& proc, MCRL2ConverterState& state);
+// The work that waits for the children of a node. It is kept on an explicit
+// stack instead of the call stack, so that the depth of a process is only
+// limited by memory. The tasks run in the reverse order of pushing, so a node
+// pushes what follows its children first and its children last.
+struct MCRL2Task final {
+    enum class Kind {
+        PROC, // convert the process `operand`
+        NEXT_OPERAND, // between the operands of a sum or parallel composition
+        CLOSE, // the end of a node with its operands on their own lines
+        CLOSE_LIST, // the end of a choice or parallel
+        CLOSE_TAU, // the end of a tau prefix
+        UNBIND // the end of the scope of the symbol `operand`
+    };
+
+    Kind kind;
+    uint32_t operand;
+};
 
+using MCRL2Tasks = std::vector<MCRL2Task>;
+
+// The binary encoding nests the operands to the left, as the parser used to,
+// so a + b + c is summation(summation(a, b), c).
 static void convert_binary_proc_to_mcrl2(
-    const std::string& kind,
-    const Proc& lhs,
-    const Proc& rhs,
-    MCRL2ConverterState& state
+    const char* kind,
+    ProcRange operands,
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
-    state.output += kind;
-    state.output += "(\n";
+    for (size_t i = 1; i < operands.size(); i++) {
+        state.output += kind;
+        state.output += "(";
+        state.indentation_counter++;
+        add_line_break(state);
+    }
+    for (size_t i = operands.size() - 1; i > 0; i--) {
+        tasks.push_back(MCRL2Task { MCRL2Task::Kind::CLOSE, 0 });
+        tasks.push_back(MCRL2Task { MCRL2Task::Kind::PROC, operands[i] });
+        tasks.push_back(MCRL2Task { MCRL2Task::Kind::NEXT_OPERAND, 0 });
+    }
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::PROC, operands[0] });
+}
+
+// The n-ary encoding is a single list, with the operands of nested nodes of
+// the same kind, as in (a + b) + c, taken into it. parallel([a, b, c]) stands
+// for the left-nested (a | b) | c, so a | (b | c) keeps its nested node.
+static void convert_nary_proc_to_mcrl2(
+    const Module& mod,
+    const char* kind_name,
+    ProcKind kind,
+    ProcRange proc_operands,
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
+) {
+    std::vector<ProcIndex> operands;
+    std::vector<ProcIndex> nested(proc_operands.begin(), proc_operands.end());
+    while (!nested.empty()) {
+        auto next = nested.back();
+        nested.pop_back();
+        // the first operand is the last one on the stack
+        bool spliced = mod.kinds[next] == kind && (kind == ProcKind::SUM || nested.empty());
+        if (!spliced) {
+            operands.push_back(next);
+            continue;
+        }
+        auto next_operands = mod.get_operands(next);
+        nested.insert(nested.end(), next_operands.begin(), next_operands.end());
+    }
+
+    // `operands` is in reverse order, so it can be pushed as it is
+    state.output += kind_name;
+    state.output += "([";
     state.indentation_counter++;
-    add_indentation(state);
-    convert_proc_to_mcrl2(lhs, state);
-    state.output += ",\n";
-    add_indentation(state);
-    convert_proc_to_mcrl2(rhs, state);
-    state.output += "\n";
-    state.indentation_counter--;
-    add_indentation(state);
-    state.output += ")";
+    add_line_break(state);
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::CLOSE_LIST, 0 });
+    for (size_t i = 0; i + 1 < operands.size(); i++) {
+        tasks.push_back(MCRL2Task { MCRL2Task::Kind::PROC, operands[i] });
+        tasks.push_back(MCRL2Task { MCRL2Task::Kind::NEXT_OPERAND, 0 });
+    }
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::PROC, operands.back() });
+}
+
+// the suffix is converted with `indentation_counter` one higher
+static void convert_suffix_to_mcrl2(ProcIndex proc, MCRL2ConverterState& state, MCRL2Tasks& tasks) {
+    state.output += ",";
+    state.indentation_counter++;
+    add_line_break(state, " ");
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::CLOSE, 0 });
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::PROC, proc });
 }
 
 static void convert_prefix_proc_to_mcrl2(
-    const std::string& kind,
+    const char* kind,
     int subject_name,
     int object_name,
-    const Proc& proc,
-    MCRL2ConverterState& state
+    ProcIndex proc,
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
     state.output += kind;
     state.output += "(";
-    state.output += std::to_string(subject_name);
+    state.output.append_number(subject_name);
     state.output += ", ";
-    state.output += std::to_string(object_name);
-    state.output += ",\n";
-    state.indentation_counter++;
-    add_indentation(state);
-    convert_proc_to_mcrl2(proc, state);
-    state.indentation_counter--;
-    state.output += "\n";
-    add_indentation(state);
-    state.output += ")";
+    state.output.append_number(object_name);
+    convert_suffix_to_mcrl2(proc, state, tasks);
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const ZeroProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
     state.output += "zero";
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const TauPrefixProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
     state.output += "tau_prefix(";
-    convert_proc_to_mcrl2(*proc.proc, state);
-    state.output += ")";
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::CLOSE_TAU, 0 });
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::PROC, proc.proc });
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const PositivePrefixProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
     auto subject_name = get_bound_name(proc.subject, loc, state);
     if (!subject_name) return;
 
     auto object_name = add_bound_name(proc.object, state);
 
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::UNBIND, proc.object.symbol });
     convert_prefix_proc_to_mcrl2(
         "input_prefix",
         *subject_name,
-        object_name.first,
-        *proc.proc,
-        state
+        object_name,
+        proc.proc,
+        state,
+        tasks
     );
-
-    remove_bound_name(proc.object, object_name, state);
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const NegativePrefixProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
     auto subject_name = get_bound_name(proc.subject, loc, state);
     auto object_name = get_bound_name(proc.object, loc, state);
@@ -152,98 +219,103 @@ static void convert_proc_to_mcrl2(
         "output_prefix",
         *subject_name,
         *object_name,
-        *proc.proc,
-        state
+        proc.proc,
+        state,
+        tasks
     );
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const MatchProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
     auto matched_name1 = get_bound_name(proc.name1, loc, state);
     auto matched_name2 = get_bound_name(proc.name2, loc, state);
     if (!matched_name1 || !matched_name2) return;
 
-    state.output += "match_proc(";
-    state.output += std::to_string(*matched_name1);
+    state.output += "match(";
+    state.output.append_number(*matched_name1);
     state.output += ", ";
-    state.output += std::to_string(*matched_name2);
-    state.output += ",\n";
-    state.indentation_counter++;
-    add_indentation(state);
-    convert_proc_to_mcrl2(*proc.proc, state);
-    state.output += "\n";
-    state.indentation_counter--;
-    add_indentation(state);
-    state.output += ")";
+    state.output.append_number(*matched_name2);
+    convert_suffix_to_mcrl2(proc.proc, state, tasks);
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const RestrictionProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
     auto restricted_name = add_bound_name(proc.name, state);
 
     state.output += "restriction(";
-    state.output += std::to_string(restricted_name.first);
-    state.output += ",\n";
-    state.indentation_counter++;
-    add_indentation(state);
-    convert_proc_to_mcrl2(*proc.proc, state);
-    state.indentation_counter--;
-    state.output += "\n";
-    add_indentation(state);
-    state.output += ")";
-
-    remove_bound_name(proc.name, restricted_name, state);
+    state.output.append_number(restricted_name);
+    tasks.push_back(MCRL2Task { MCRL2Task::Kind::UNBIND, proc.name.symbol });
+    convert_suffix_to_mcrl2(proc.proc, state, tasks);
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const SumProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
-    convert_binary_proc_to_mcrl2(
-        "summation",
-        *proc.lhs,
-        *proc.rhs,
-        state
-    );
+    if (state.nary) {
+        convert_nary_proc_to_mcrl2(mod, "choice", ProcKind::SUM, proc.operands, state, tasks);
+    } else {
+        convert_binary_proc_to_mcrl2("summation", proc.operands, state, tasks);
+    }
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const ParallelProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
-    convert_binary_proc_to_mcrl2(
-        "parallel_composition",
-        *proc.lhs,
-        *proc.rhs,
-        state
-    );
+    if (state.nary) {
+        convert_nary_proc_to_mcrl2(mod, "parallel", ProcKind::PARALLEL, proc.operands, state, tasks);
+    } else {
+        convert_binary_proc_to_mcrl2("parallel_composition", proc.operands, state, tasks);
+    }
 }
 
 static void convert_proc_to_mcrl2(
+    const Module& mod,
     const IdentifierProc& proc,
     SourceLocation loc,
-    MCRL2ConverterState& state
+    MCRL2ConverterState& state,
+    MCRL2Tasks& tasks
 ) {
-    auto var = state.variable_map.find(proc.variable_id);
-    if (var == state.variable_map.end()) {
+    auto var = state.variable_map[proc.variable_id.symbol];
+    if (!var.has_value()) {
         state.errors.push_back(Error(
             ErrorType::IDENTIFIER,
             loc,
-            "Unknown recursion variable `" + proc.variable_id.value + "`"
+            "Unknown recursion variable `" + std::string(proc.variable_id.value) + "`"
+        ));
+        return;
+    }
+
+    auto& decl = mod.declarations[*var];
+    if (decl.params.size() != proc.args.size()) {
+        state.errors.push_back(Error(
+            ErrorType::IDENTIFIER,
+            loc,
+            "Agent `" + std::string(proc.variable_id.value) + "` expects " +
+                std::to_string(decl.params.size()) + " arguments"
         ));
         return;
     }
 
     state.output += "identifier(";
-    state.output += std::to_string(var->second);
+    state.output.append_number(*var);
     state.output += ", [";
     bool error = false;
     for (int i = 0; i < proc.args.size(); i++) {
@@ -252,56 +324,93 @@ static void convert_proc_to_mcrl2(
         if (i > 0) {
             state.output += ", ";
         }
-        state.output += std::to_string(*name);
+        state.output.append_number(*name);
     }
     state.output += "])";
 }
 
 static void convert_proc_to_mcrl2(
-    const Proc& proc,
+    const Module& mod,
+    ProcIndex root,
     MCRL2ConverterState& state
 ) {
-    auto loc = proc.get_loc();
-    const_cast<Proc&>(proc).visit<void>([&](auto& arg) {
-        convert_proc_to_mcrl2(arg, loc, state);
-    });
+    MCRL2Tasks tasks { MCRL2Task { MCRL2Task::Kind::PROC, root } };
+    while (!tasks.empty()) {
+        auto task = tasks.back();
+        tasks.pop_back();
+        switch (task.kind) {
+            case MCRL2Task::Kind::PROC: {
+                auto loc = mod.get_loc(task.operand);
+                mod.visit<void>(task.operand, [&](auto& arg) {
+                    convert_proc_to_mcrl2(mod, arg, loc, state, tasks);
+                });
+                break;
+            }
+            case MCRL2Task::Kind::NEXT_OPERAND:
+                state.output += ",";
+                add_line_break(state, " ");
+                break;
+            case MCRL2Task::Kind::CLOSE:
+                state.indentation_counter--;
+                add_line_break(state);
+                state.output += ")";
+                break;
+            case MCRL2Task::Kind::CLOSE_LIST:
+                state.indentation_counter--;
+                add_line_break(state);
+                state.output += "])";
+                break;
+            case MCRL2Task::Kind::CLOSE_TAU:
+                state.output += ")";
+                break;
+            case MCRL2Task::Kind::UNBIND:
+                remove_bound_name(task.operand, state);
+                break;
+        }
+    }
 }
 
 static void convert_decl_to_mcrl2(
+    const Module& mod,
     const ProcDecl& decl,
     MCRL2ConverterState& state
 ) {
-    // add parameter names to map
-    std::vector<std::pair<int, std::optional<int>>> pairs;
+    // add parameter names to map; they are always 0, ..., arity - 1
+    int next_binder = state.name_counter;
+    state.name_counter = 0;
     for (auto& id : decl.params) {
-        pairs.push_back(add_bound_name(id, state));
+        add_bound_name(id, state);
+    }
+    if (state.unique_names) {
+        state.name_counter = next_binder;
     }
 
     state.output += "pi_definition(";
-    state.output += std::to_string(decl.params.size());
-    state.output += ",\n";
+    state.output.append_number(decl.params.size());
+    state.output += ",";
     state.indentation_counter++;
-    add_indentation(state);
-    convert_proc_to_mcrl2(*decl.proc, state);
+    add_line_break(state, " ");
+    convert_proc_to_mcrl2(mod, decl.proc, state);
     state.indentation_counter--;
-    state.output += "\n";
-    add_indentation(state);
+    add_line_break(state);
     state.output += ")";
 
     // remove parameter names from map
-    for (int i = pairs.size() - 1; i >= 0; i--) {
-        remove_bound_name(decl.params[i], pairs[i], state);
+    for (int i = decl.params.size() - 1; i >= 0; i--) {
+        remove_bound_name(decl.params[i].symbol, state);
     }
 }
 
 void convert_module_to_mcrl2(const Module& mod, MCRL2ConverterState& state) {
+    state.name_map.resize(mod.symbols.size());
+    state.variable_map.resize(mod.symbols.size());
     std::optional<int> main_index;
 
     bool error = false;
     for (int i = 0; i < mod.declarations.size(); i++) {
         auto& decl = mod.declarations[i];
-        auto it = state.variable_map.find(decl.id);
-        if (it != state.variable_map.end()) {
+        auto& var = state.variable_map[decl.id.symbol];
+        if (var.has_value()) {
             state.errors.push_back(Error {
                 ErrorType::IDENTIFIER,
                 decl.loc,
@@ -309,7 +418,7 @@ void convert_module_to_mcrl2(const Module& mod, MCRL2ConverterState& state) {
             });
             error = true;
         }
-        state.variable_map[decl.id] = i;
+        var = i;
 
         if (decl.id.value == "Main") {
             main_index = i;
@@ -327,47 +436,82 @@ void convert_module_to_mcrl2(const Module& mod, MCRL2ConverterState& state) {
 
     if (error) return;
 
-    state.output += "(lambda id': PiIdentifier . pi_definition(0, zero))";
+    if (state.unique_names) {
+        // binders never coincide with a parameter or a name from pi_names, so
+        // instantiating a definition does not need alpha-conversion
+        state.name_counter = state.names_bound;
+        for (auto& decl : mod.declarations) {
+            state.name_counter = std::max(state.name_counter, static_cast<int>(decl.params.size()));
+        }
+    }
+
+    state.output += "eqn pi_names = { name': PiName | name' < ";
+    state.output.append_number(state.names_bound);
+    state.output += " };\n\n";
+
+    // one equation per agent, so that the rewriter finds a definition directly
+    state.output += "map pi_defs: PiIdentifier -> PiDefinition;\n\neqn\n";
+    state.indentation_counter++;
     for (auto& decl : mod.declarations) {
-        int index = state.variable_map.find(decl.id)->second;
-        state.output += "[";
-        state.output += std::to_string(index);
-        state.output += " -> ";
-        convert_decl_to_mcrl2(decl, state);
-        state.output += "]";
+        int index = *state.variable_map[decl.id.symbol];
+        add_indentation(state);
+        state.output += "pi_defs(";
+        state.output.append_number(index);
+        state.output += ") = ";
+        convert_decl_to_mcrl2(mod, decl, state);
+        state.output += ";\n";
     }
+    state.indentation_counter--;
 
-    state.output += ",\n";
+    state.output += "\ninit PiInterpreter(\n";
+    state.indentation_counter++;
+    add_indentation(state);
+    state.output += "pi_defs,\n";
     add_indentation(state);
     state.output += "identifier(";
-    state.output += std::to_string(*main_index);
+    state.output.append_number(*main_index);
     state.output += ", [";
     auto& main_decl = mod.declarations[*main_index];
     for (int i = 0; i < main_decl.params.size(); i++) {
         if (i > 0) {
             state.output += ", ";
         }
-        state.output += std::to_string(i);
+        state.output.append_number(i);
     }
-    state.output += "])";
+    state.output += "])\n";
+    state.indentation_counter--;
+    state.output += ");\n";
 }
 
-Expected<std::string> convert_module_to_mcrl2(const Module& mod) {
+Expected<size_t> convert_module_to_mcrl2(
+    const Module& mod,
+    int names_bound,
+    bool unique_names,
+    bool nary,
+    bool compact,
+    OutputSink& output
+) {
     MCRL2ConverterState state {
-        "    ",
+        compact ? "" : "    ",
         0,
-        "",
+        output,
         std::vector<Error>(),
-        std::unordered_map<Identifier, int>(),
-        std::unordered_map<Identifier, int>()
+        std::vector<std::vector<int>>(),
+        std::vector<std::optional<int>>(),
+        0,
+        names_bound,
+        unique_names,
+        nary,
+        compact
     };
+    size_t start = output.bytes_written();
     convert_module_to_mcrl2(mod, state);
 
     if (state.errors.size() > 0) {
-        return Expected<std::string>(std::move(state.errors));
+        return Expected<size_t>(std::move(state.errors));
     }
 
-    return std::move(state.output);
+    return output.bytes_written() - start;
 }
 
 } // end namespace picalc
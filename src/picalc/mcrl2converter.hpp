@@ -2,24 +2,45 @@
 #define PICALC_MCRL2CONVERTER_H
 
 #include "ast.hpp"
+#include "outputsink.hpp"
 
-#include <unordered_map>
+#include <optional>
+#include <vector>
 
 namespace picalc {
 
 struct MCRL2ConverterState {
     std::string indentation_string;
     int indentation_counter;
-    std::string output;
+    OutputSink& output;
     std::vector<Error> errors;
-    std::unordered_map<Identifier, int> name_map;
-    std::unordered_map<Identifier, int> variable_map;
+    std::vector<std::vector<int>> name_map; // per symbol: the numbers of the enclosing binders
+    std::vector<std::optional<int>> variable_map; // per symbol: the index of its declaration
     int name_counter;
+    int names_bound; // pi_names = { name': PiName | name' < names_bound }
+    bool unique_names; // never reuse the number of a binder
+    bool nary; // choice and parallel over lists instead of binary summation and parallel_composition
+    bool compact; // every pi_defs equation on one line, without indentation
 };
 
 void convert_module_to_mcrl2(const Module& module, MCRL2ConverterState& state);
 
-Expected<std::string> convert_module_to_mcrl2(const Module& module);
+// With `unique_names`, every binder gets its own number, starting after
+// pi_names and the parameters, instead of the lowest number not used by an
+// enclosing scope. With `nary`, the term is for mcrl2/picalc_nary.mcrl2.
+// With `compact`, the size of the output is linear in the nesting depth
+// instead of quadratic.
+//
+// The specification is streamed to `output`, which may already hold a part
+// of it if there are errors. Returns the number of bytes written.
+Expected<size_t> convert_module_to_mcrl2(
+    const Module& module,
+    int names_bound,
+    bool unique_names,
+    bool nary,
+    bool compact,
+    OutputSink& output
+);
 
 } // end namespace picalc
 
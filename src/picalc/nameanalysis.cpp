@@ -0,0 +1,169 @@
+#include "nameanalysis.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace picalc {
+
+// The functions below compute an upper bound on the number of free names of
+// a process and of every state derived from it, together with the free names
+// of the process itself. Substituting names can merge them, but
+// never adds any, so the bound of an agent also holds for every call.
+struct LiveNames {
+    int live;
+    std::unordered_set<Identifier> free;
+};
+
+// The overloads below take the results of the children of the node from the
+// top of `stack`, where the post-order pass of compute_names_bound put them.
+using LiveNamesStack = std::vector<LiveNames>;
+
+static LiveNames pop(LiveNamesStack& stack) {
+    auto result = std::move(stack.back());
+    stack.pop_back();
+    return result;
+}
+
+static LiveNames live_names_prefix(
+    std::vector<Identifier> names,
+    const Identifier* bound_name,
+    LiveNamesStack& stack
+) {
+    // a bound name is free in the states after the input or extrusion
+    auto result = pop(stack);
+    if (bound_name != nullptr) {
+        result.free.erase(*bound_name);
+    }
+    result.free.insert(names.begin(), names.end());
+    result.live = std::max(result.live, static_cast<int>(result.free.size()));
+    return result;
+}
+
+static LiveNames live_names(const ZeroProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    return LiveNames { 0, {} };
+}
+
+static LiveNames live_names(const TauPrefixProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    return live_names_prefix({}, nullptr, stack);
+}
+
+static LiveNames live_names(const PositivePrefixProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    return live_names_prefix({ proc.subject }, &proc.object, stack);
+}
+
+static LiveNames live_names(const NegativePrefixProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    return live_names_prefix({ proc.subject, proc.object }, nullptr, stack);
+}
+
+static LiveNames live_names(const MatchProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    return live_names_prefix({ proc.name1, proc.name2 }, nullptr, stack);
+}
+
+static LiveNames live_names(const RestrictionProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    return live_names_prefix({}, &proc.name, stack);
+}
+
+// the results of the last `count` nodes, merged into the first of them
+static LiveNames pop_merged(size_t count, bool parallel, LiveNamesStack& stack) {
+    auto first = stack.end() - count;
+    auto result = std::move(*first);
+    for (auto it = first + 1; it != stack.end(); it++) {
+        result.free.insert(it->free.begin(), it->free.end());
+        // parallel components can hold all of their names at the same time
+        result.live = parallel ? result.live + it->live : std::max(result.live, it->live);
+    }
+    stack.erase(first, stack.end());
+    if (!parallel) {
+        result.live = std::max(result.live, static_cast<int>(result.free.size()));
+    }
+    return result;
+}
+
+static LiveNames live_names(const SumProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    return pop_merged(proc.operands.size(), false, stack);
+}
+
+static LiveNames live_names(const ParallelProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    return pop_merged(proc.operands.size(), true, stack);
+}
+
+static LiveNames live_names(const IdentifierProc& proc, LiveNamesStack& stack, const NameAnalysisState& state) {
+    LiveNames result { 0, std::unordered_set<Identifier>(proc.args.begin(), proc.args.end()) };
+    auto var = state.variable_map[proc.variable_id.symbol];
+    if (var.has_value()) { // otherwise reported by the converters
+        result.live = state.live_names[*var];
+    }
+    result.live = std::max(result.live, static_cast<int>(result.free.size()));
+    return result;
+}
+
+Expected<int> compute_names_bound(const Module& mod) {
+    NameAnalysisState state;
+    state.variable_map.resize(mod.symbols.size());
+    std::optional<int> main_index;
+
+    for (int i = 0; i < mod.declarations.size(); i++) {
+        auto& decl = mod.declarations[i];
+        state.variable_map[decl.id.symbol] = i;
+        if (decl.id.value == "Main") {
+            main_index = i;
+        }
+    }
+
+    if (!main_index.has_value()) {
+        return Expected<int>(Error {
+            ErrorType::IDENTIFIER,
+            SourceLocation(0, 0),
+            "No starting process found; it should be called `Main`"
+        });
+    }
+
+    // least fixed point; without recursion through parallel composition it is
+    // reached after at most two rounds per agent
+    state.live_names.assign(mod.declarations.size(), 0);
+    int max_rounds = 2 * mod.declarations.size() + 1;
+    for (int round = 0; round <= max_rounds; round++) {
+        std::optional<int> changed;
+        LiveNamesStack stack;
+        int i = 0;
+        for (ProcIndex proc = 0; proc < mod.kinds.size(); proc++) {
+            stack.push_back(mod.visit<LiveNames>(proc, [&](auto& arg) {
+                return live_names(arg, stack, state);
+            }));
+            if (proc != mod.declarations[i].proc) {
+                continue;
+            }
+
+            // the root of the next declaration
+            int value = pop(stack).live;
+            if (value > state.live_names[i]) {
+                state.live_names[i] = value;
+                if (!changed.has_value()) {
+                    changed = i;
+                }
+            }
+            i++;
+        }
+
+        if (!changed.has_value()) {
+            auto& main_decl = mod.declarations[*main_index];
+            int bound = std::max(static_cast<int>(main_decl.params.size()), state.live_names[*main_index]);
+            return bound + 1; // one more for a fresh name
+        }
+
+        if (round == max_rounds) {
+            auto& decl = mod.declarations[*changed];
+            state.errors.push_back(Error {
+                ErrorType::UNSUPPORTED,
+                decl.loc,
+                "The number of names used by `" + std::string(decl.id.value) +
+                    "` is unbounded, because it spawns parallel components recursively; " +
+                    "use --names to give the bound explicitly"
+            });
+        }
+    }
+
+    return Expected<int>(std::move(state.errors));
+}
+
+} // end namespace picalc
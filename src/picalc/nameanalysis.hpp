@@ -0,0 +1,33 @@
+#ifndef PICALC_NAMEANALYSIS_H
+#define PICALC_NAMEANALYSIS_H
+
+#include "ast.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace picalc {
+
+struct NameAnalysisState {
+    std::vector<Error> errors;
+    std::vector<std::optional<int>> variable_map; // per symbol: the index of its declaration
+    std::vector<int> live_names; // per declaration, for distinct arguments
+};
+
+// Computes a bound N such that `pi_names = { name': PiName | name' < N }` is
+// sufficient: every reachable state has fewer than N free names, so the
+// INPUT and OPEN rules can always pick a fresh name, and the free names of
+// every state (Main's parameters and the picked names) are below N.
+//
+// A restricted name counts as free in the scope of its restriction while it
+// is used there, as RES keeps it from being picked. Once it is no longer
+// used, RES lets it be picked again, and so do the INPUT and OPEN rules for
+// the binders, so their names need not be counted.
+//
+// Fails if the number of live names is unbounded, which happens when an agent
+// recursively spawns parallel components.
+Expected<int> compute_names_bound(const Module& module);
+
+} // end namespace picalc
+
+#endif
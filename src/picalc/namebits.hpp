@@ -0,0 +1,59 @@
+#ifndef PICALC_NAMEBITS_H
+#define PICALC_NAMEBITS_H
+
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace picalc {
+
+// A set of the names below 256 as a bitset. Names from 256 onwards set the
+// overflow flag instead, after which the set is only an under-approximation
+// and the caller has to fall back to the exact sets of agent.hpp.
+struct NameBits final {
+    static constexpr uint32_t CAPACITY = 256;
+
+    alignas(16) uint64_t words[4] = { 0, 0, 0, 0 };
+    bool overflow = false;
+
+    void insert(uint32_t name) {
+        if (name >= CAPACITY) {
+            overflow = true;
+            return;
+        }
+        words[name / 64] |= uint64_t(1) << (name % 64);
+    }
+
+    void erase(uint32_t name) {
+        if (name < CAPACITY) {
+            words[name / 64] &= ~(uint64_t(1) << (name % 64));
+        }
+    }
+
+    bool contains(uint32_t name) const {
+        return name < CAPACITY && (words[name / 64] >> (name % 64)) & 1;
+    }
+
+    void insert_all(const NameBits& other) {
+#ifdef __SSE2__
+        auto words_ptr = reinterpret_cast<__m128i*>(words);
+        auto other_ptr = reinterpret_cast<const __m128i*>(other.words);
+        _mm_store_si128(words_ptr, _mm_or_si128(_mm_load_si128(words_ptr), _mm_load_si128(other_ptr)));
+        _mm_store_si128(
+            words_ptr + 1,
+            _mm_or_si128(_mm_load_si128(words_ptr + 1), _mm_load_si128(other_ptr + 1))
+        );
+#else
+        for (int i = 0; i < 4; i++) {
+            words[i] |= other.words[i];
+        }
+#endif
+        overflow = overflow || other.overflow;
+    }
+};
+
+} // end namespace picalc
+
+#endif
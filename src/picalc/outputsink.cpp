@@ -0,0 +1,127 @@
+#include "outputsink.hpp"
+
+#include <cerrno>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace picalc {
+
+Expected<OutputSink> OutputSink::open(const std::string& path) {
+    // devices and pipes such as /dev/null cannot be replaced by a rename
+    struct stat status;
+    bool in_place = stat(path.c_str(), &status) == 0 && !S_ISREG(status.st_mode);
+    std::string temporary_path = in_place ? "" : path + ".tmp";
+
+    int fd = ::open(in_place ? path.c_str() : temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return Expected<OutputSink>(Error {
+            ErrorType::CLI,
+            SourceLocation(0, 0),
+            "Could not open output file `" + path + "`"
+        });
+    }
+    return OutputSink(fd, path, std::move(temporary_path));
+}
+
+OutputSink OutputSink::standard_output() {
+    return OutputSink(STDOUT_FILENO, "", "");
+}
+
+OutputSink::OutputSink(int fd, std::string path, std::string temporary_path) :
+    fd(fd),
+    path(std::move(path)),
+    temporary_path(std::move(temporary_path)),
+    buffer(new char[buffer_size]) {}
+
+OutputSink::OutputSink(OutputSink&& rhs) noexcept :
+    fd(rhs.fd),
+    path(std::move(rhs.path)),
+    temporary_path(std::move(rhs.temporary_path)),
+    buffer(std::move(rhs.buffer)),
+    used(rhs.used),
+    flushed(rhs.flushed),
+    failed(rhs.failed),
+    committed(rhs.committed)
+{
+    rhs.fd = -1;
+    rhs.temporary_path.clear();
+    rhs.committed = true;
+}
+
+OutputSink& OutputSink::operator=(OutputSink&& rhs) noexcept {
+    std::swap(fd, rhs.fd);
+    std::swap(path, rhs.path);
+    std::swap(temporary_path, rhs.temporary_path);
+    std::swap(buffer, rhs.buffer);
+    std::swap(used, rhs.used);
+    std::swap(flushed, rhs.flushed);
+    std::swap(failed, rhs.failed);
+    std::swap(committed, rhs.committed);
+    return *this;
+}
+
+OutputSink::~OutputSink() {
+    // the rest of the buffer is dropped, so a failed conversion of a small
+    // model prints nothing
+    if (committed) return;
+    if (!path.empty() && fd >= 0) {
+        close(fd);
+    }
+    if (!temporary_path.empty()) {
+        unlink(temporary_path.c_str());
+    }
+}
+
+void OutputSink::append_large(std::string_view text) {
+    flush();
+    if (text.size() < buffer_size) {
+        std::memcpy(buffer.get(), text.data(), text.size());
+        used = text.size();
+    } else {
+        write(text.data(), text.size());
+        flushed += text.size();
+    }
+}
+
+void OutputSink::write(const char* data, size_t size) {
+    while (size > 0 && !failed) {
+        ssize_t result = ::write(fd, data, size);
+        if (result < 0) {
+            failed = errno != EINTR;
+            continue;
+        }
+        data += result;
+        size -= result;
+    }
+}
+
+void OutputSink::flush() {
+    write(buffer.get(), used);
+    flushed += used;
+    used = 0;
+}
+
+Expected<size_t> OutputSink::commit() {
+    flush();
+    if (!path.empty()) {
+        failed = close(fd) != 0 || failed;
+        fd = -1;
+    }
+    if (!failed && !temporary_path.empty()) {
+        failed = std::rename(temporary_path.c_str(), path.c_str()) != 0;
+    }
+    if (failed) {
+        return Expected<size_t>(Error {
+            ErrorType::CLI,
+            SourceLocation(0, 0),
+            path.empty() ? "Could not write to the standard output" : "Could not write output file `" + path + "`"
+        });
+    }
+    committed = true;
+    return flushed;
+}
+
+} // end namespace picalc
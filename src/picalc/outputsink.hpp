@@ -0,0 +1,95 @@
+#ifndef PICALC_OUTPUTSINK_H
+#define PICALC_OUTPUTSINK_H
+
+#include "core.hpp"
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace picalc {
+
+// Buffers the generated text and writes it out in blocks, so that the
+// converters can stream a specification of any size without holding it in
+// memory.
+class OutputSink final {
+public:
+    // A regular file is written to `<path>.tmp` and only renamed to `path` by
+    // commit(), so that a failed conversion leaves `path` alone.
+    static Expected<OutputSink> open(const std::string& path);
+
+    static OutputSink standard_output();
+
+    OutputSink(OutputSink&& rhs) noexcept;
+
+    OutputSink& operator=(OutputSink&& rhs) noexcept;
+
+    OutputSink(const OutputSink&) = delete;
+
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    // removes the temporary file if there was no commit
+    ~OutputSink();
+
+    OutputSink& operator+=(std::string_view text) {
+        if (text.size() <= buffer_size - used) {
+            std::memcpy(buffer.get() + used, text.data(), text.size());
+            used += text.size();
+        } else {
+            append_large(text);
+        }
+        return *this;
+    }
+
+    OutputSink& operator+=(char c) {
+        if (used == buffer_size) {
+            flush();
+        }
+        buffer[used++] = c;
+        return *this;
+    }
+
+    void append_number(long long value) {
+        if (buffer_size - used < max_number_length) {
+            flush();
+        }
+        auto result = std::to_chars(buffer.get() + used, buffer.get() + buffer_size, value);
+        used = result.ptr - buffer.get();
+    }
+
+    size_t bytes_written() const {
+        return flushed + used;
+    }
+
+    // writes out the buffer and moves a file into place; returns the size of
+    // the output
+    Expected<size_t> commit();
+
+private:
+    static constexpr size_t buffer_size = 1 << 16;
+    static constexpr size_t max_number_length = 20; // including the sign
+
+    OutputSink(int fd, std::string path, std::string temporary_path);
+
+    void append_large(std::string_view text);
+
+    void write(const char* data, size_t size);
+
+    void flush();
+
+    int fd;
+    std::string path; // empty for the standard output
+    std::string temporary_path; // empty if the file is written in place
+    std::unique_ptr<char[]> buffer;
+    size_t used = 0;
+    size_t flushed = 0;
+    bool failed = false; // a write failed; reported by commit()
+    bool committed = false;
+};
+
+} // end namespace picalc
+
+#endif
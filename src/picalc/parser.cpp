@@ -4,8 +4,8 @@
 
 namespace picalc {
 
-Expected<Module> parse_module(std::vector<Token> tokens) {
-    Parser parser(std::move(tokens));
+Expected<Module> parse_module(ArenaVector<Token> tokens, SymbolTable symbols, Arena& arena) {
+    Parser parser(std::move(tokens), std::move(symbols), arena);
     auto result = parser.parse_module();
     if (!result) {
         assert(parser.errors.size() > 0);
@@ -17,7 +17,6 @@ Expected<Module> parse_module(std::vector<Token> tokens) {
 }
 
 std::optional<Module> Parser::parse_module() {
-    std::vector<ProcDecl> declarations;
     bool error = false;
     while (has_token()) {
         auto next = parse_proc_decl();
@@ -25,7 +24,7 @@ std::optional<Module> Parser::parse_module() {
             error = true;
         }
         if (!error) {
-            declarations.push_back(std::move(*next));
+            module.declarations.push_back(std::move(*next));
         } else {
             // fast-forward to the next semicolon
             while (has_token() && get_token().token_type != TokenType::SEMICOLON) {
@@ -41,7 +40,7 @@ std::optional<Module> Parser::parse_module() {
         return std::nullopt;
     }
 
-    return Module(std::move(declarations));
+    return std::move(module);
 }
 
 std::optional<ProcDecl> Parser::parse_proc_decl() {
@@ -53,7 +52,7 @@ std::optional<ProcDecl> Parser::parse_proc_decl() {
     auto id = parse_identifier();
     if (!id) return std::nullopt;
 
-    std::vector<Identifier> params;
+    ArenaVector<Identifier> params(arena);
     if (skip_if_equal(TokenType::OPENING_PAREN)) {
         auto list = parse_arg_list();
         if (!list) return std::nullopt;
@@ -78,42 +77,108 @@ std::optional<ProcDecl> Parser::parse_proc_decl() {
     return ProcDecl(
         std::move(*id),
         std::move(params),
-        std::move(*proc),
+        *proc,
         loc
     );
 }
 
-std::optional<std::unique_ptr<Proc>> Parser::parse_proc() {
-    auto result = parse_parallel_proc();
-    if (!result) return std::nullopt;
+// Proc ::= ParallelProc { + ParallelProc }
+// ParallelProc ::= UnaryProc { | UnaryProc }
+// UnaryProc ::= Prefix . UnaryProc | ( Proc ) | 0 | Call
+//
+// Prefix chains and nested parentheses can be arbitrarily deep, so instead of
+// recursing, the nodes that wait for a child are kept on `pending`. Each
+// completed UnaryProc is reduced into the nodes on top of the stack, which
+// adds the nodes in the same post-order as a recursive descent would. A chain
+// of + or | becomes a single node with all operands of the chain.
+std::optional<ProcIndex> Parser::parse_proc() {
+    pending.clear();
+    operands.clear();
+
+    // the innermost pending node, unless that is a parenthesis
+    auto top = [&]() -> const PendingProc* {
+        return pending.empty() || pending.back().paren ? nullptr : &pending.back();
+    };
+    auto reduce = [&](ProcIndex last) {
+        auto result = add_pending(pending.back(), last);
+        pending.pop_back();
+        return result;
+    };
+
+    while (true) {
+        auto unary = parse_prefixes();
+        if (!unary) return std::nullopt;
+        ProcIndex result = *unary;
+
+        while (true) {
+            while (top() && top()->kind != ProcKind::SUM && top()->kind != ProcKind::PARALLEL) {
+                result = reduce(result);
+            }
 
-    while (has_token() && get_token().token_type == TokenType::PLUS) {
-        auto loc = get_loc();
+            if (has_token() && get_token().token_type == TokenType::PIPE) {
+                add_operand(ProcKind::PARALLEL, result);
+                skip();
+                break;
+            }
+            if (top() && top()->kind == ProcKind::PARALLEL) {
+                result = reduce(result);
+            }
 
-        skip();
+            if (has_token() && get_token().token_type == TokenType::PLUS) {
+                add_operand(ProcKind::SUM, result);
+                skip();
+                break;
+            }
+            if (top() && top()->kind == ProcKind::SUM) {
+                result = reduce(result);
+            }
 
-        auto rhs = parse_parallel_proc();
-        if (!rhs) return std::nullopt;
+            if (pending.empty()) {
+                return result;
+            }
 
-        result = std::make_unique<Proc>(
-            SumProc(std::move(*result), std::move(*rhs)),
-            loc
-        );
+            // ( Proc ) is a UnaryProc again
+            assert(pending.back().paren);
+            if (!skip_if_equal(TokenType::CLOSING_PAREN)) {
+                return expected("closing `)`");
+            }
+            pending.pop_back();
+        }
     }
+}
 
-    return result;
+// adds `operand` to the chain of `kind` on top of `pending`, or starts one; the
+// current token is the operator after it
+void Parser::add_operand(ProcKind kind, ProcIndex operand) {
+    if (pending.empty() || pending.back().paren || pending.back().kind != kind) {
+        pending.push_back(PendingProc { kind, { 0, 0 }, operands.size(), get_loc(), false });
+    }
+    // like the root of a left-nested chain, the node is at the last operator
+    pending.back().loc = get_loc();
+    operands.push_back(operand);
 }
 
-std::optional<std::vector<Identifier>> Parser::parse_arg_list() {
+ProcIndex Parser::add_pending(const PendingProc& proc, ProcIndex last) {
+    if (proc.kind == ProcKind::SUM || proc.kind == ProcKind::PARALLEL) {
+        operands.push_back(last);
+        auto first = operands.data() + proc.first_operand;
+        auto result = module.add_operands(proc.kind, first, operands.size() - proc.first_operand, proc.loc);
+        operands.resize(proc.first_operand);
+        return result;
+    }
+    return module.add_proc(proc.kind, last, proc.names, proc.loc);
+}
+
+std::optional<ArenaVector<Identifier>> Parser::parse_arg_list() {
     if (!has_token()) {
         return eof();
     }
 
-    std::vector<Identifier> result;
+    ArenaVector<Identifier> result(arena);
 
     auto token = &get_token();
     while (token->token_type == TokenType::IDENTIFIER) {
-        result.push_back(Identifier(token->value));
+        result.push_back(Identifier(token->symbol, token->value));
         skip();
         if (!has_token() || get_token().token_type != TokenType::COMMA) {
             break;
@@ -128,200 +193,138 @@ std::optional<std::vector<Identifier>> Parser::parse_arg_list() {
     return result;
 }
 
-std::optional<std::unique_ptr<Proc>> Parser::parse_parallel_proc() {
-    auto result = parse_unary_proc();
-    if (!result) return std::nullopt;
+// Pushes the prefixes and opening parentheses in front of the next zero or
+// call onto `pending`, and returns that zero or call.
+std::optional<ProcIndex> Parser::parse_prefixes() {
+    while (true) {
+        if (!has_token()) {
+            return eof();
+        }
 
-    while (has_token() && get_token().token_type == TokenType::PIPE) {
+        auto token_type = get_token().token_type;
         auto loc = get_loc();
 
-        skip();
-
-        auto rhs = parse_unary_proc();
-        if (!rhs) return std::nullopt;
-
-        result = std::make_unique<Proc>(
-            ParallelProc(std::move(*result), std::move(*rhs)),
-            loc
-        );
-    }
-
-    return result;
-}
-
-std::optional<std::unique_ptr<Proc>> Parser::parse_unary_proc() {
-    if (!has_token()) {
-        return eof();
-    }
-
-    auto token_type = get_token().token_type;
-    auto loc = get_loc();
+        // tau . UnaryProc
+        if (token_type == TokenType::TAU) {
+            skip();
+            if (!skip_if_equal(TokenType::PERIOD)) {
+                return expected("`.` in tau prefix");
+            }
 
-    // tau . UnaryProc
-    if (token_type == TokenType::TAU) {
-        skip();
-        if (!skip_if_equal(TokenType::PERIOD)) {
-            return expected("`.` in tau prefix");
+            pending.push_back(PendingProc { ProcKind::TAU_PREFIX, { 0, 0 }, 0, loc, false });
+            continue;
         }
 
-        auto suffix = parse_unary_proc();
-        if (!suffix) return std::nullopt;
+        // A ( a_1, ..., a_n ) or A
+        // a ( b ) . UnaryProc
+        // a ' b . UnaryProc
+        if (token_type == TokenType::IDENTIFIER) {
+            Identifier subject(get_token().symbol, get_token().value);
+            skip();
+            if (skip_if_equal(TokenType::OPENING_PAREN)) {
+                if (skip_if_equal(TokenType::CLOSING_PAREN)) {
+                    // A ( )
+                    return module.add_call(subject, ArenaVector<Identifier>(arena), loc);
+                }
 
-        return std::make_unique<Proc>(
-            TauPrefixProc(std::move(*suffix)),
-            loc
-        );
-    }
+                auto args = parse_arg_list();
+                if (!args) return std::nullopt;
 
-    // A ( a_1, ..., a_n ) or A
-    // a ( b ) . UnaryProc
-    // a ' b . UnaryProc
-    if (token_type == TokenType::IDENTIFIER) {
-        auto subject = get_token().value;
-        skip();
-        if (skip_if_equal(TokenType::OPENING_PAREN)) {
-            if (skip_if_equal(TokenType::CLOSING_PAREN)) {
-                // A ( )
-                return std::make_unique<Proc>(
-                    IdentifierProc(
-                        Identifier(std::move(subject)),
-                        std::vector<Identifier>()
-                    ),
-                    loc
-                );
-            }
+                if (!skip_if_equal(TokenType::CLOSING_PAREN)) {
+                    return expected("`)` as closing delimiter for recursive call");
+                }
 
-            auto args = parse_arg_list();
-            if (!args) return std::nullopt;
+                if (skip_if_equal(TokenType::PERIOD)) {
+                    // A ( a ) . UnaryProc
+                    if ((*args).size() != 1) {
+                        return syntax_error("an input prefix must have only one object");
+                    }
+
+                    pending.push_back(PendingProc {
+                        ProcKind::POSITIVE_PREFIX,
+                        { subject.symbol, (*args)[0].symbol },
+                        0,
+                        loc,
+                        false
+                    });
+                    continue;
+                }
 
-            if (!skip_if_equal(TokenType::CLOSING_PAREN)) {
-                return expected("`)` as closing delimiter for recursive call");
-            }
+                return module.add_call(subject, std::move(*args), loc);
+            } else if (skip_if_equal(TokenType::APOSTROPHE)) {
+                auto object = parse_identifier();
+                if (!object) return std::nullopt;
 
-            if (skip_if_equal(TokenType::PERIOD)) {
-                // A ( a ) . UnaryProc
-                if ((*args).size() != 1) {
-                    return syntax_error("an input prefix must have only one object");
+                if (!skip_if_equal(TokenType::PERIOD)) {
+                    return expected("`.` in an output prefix");
                 }
 
-                auto proc = parse_unary_proc();
-                if (!proc) return std::nullopt;
-
-                return std::make_unique<Proc>(
-                    PositivePrefixProc(
-                        Identifier(std::move(subject)),
-                        (*args)[0],
-                        std::move(*proc)
-                    ),
-                    loc
-                );
+                pending.push_back(PendingProc {
+                    ProcKind::NEGATIVE_PREFIX,
+                    { subject.symbol, (*object).symbol },
+                    0,
+                    loc,
+                    false
+                });
+                continue;
+            } else {
+                return module.add_call(subject, ArenaVector<Identifier>(arena), loc);
             }
+        }
 
-            return std::make_unique<Proc>(
-                IdentifierProc(
-                    Identifier(std::move(subject)),
-                    std::move(*args)
-                ),
-                loc
-            );
-        } else if (skip_if_equal(TokenType::APOSTROPHE)) {
-            auto object = parse_identifier();
-            if (!object) return std::nullopt;
+        // [ a = b ] UnaryProc
+        if (token_type == TokenType::OPENING_BRACKET) {
+            skip();
+            auto id1 = parse_identifier();
+            if (!id1) return std::nullopt;
 
-            if (!skip_if_equal(TokenType::PERIOD)) {
-                return expected("`.` in an output prefix");
+            if (!skip_if_equal(TokenType::EQUALS)) {
+                return expected("an = sign in match clause");
             }
 
-            auto proc = parse_unary_proc();
-            if (!proc) return std::nullopt;
-
-            return std::make_unique<Proc>(
-                NegativePrefixProc(
-                    Identifier(std::move(subject)),
-                    std::move(*object),
-                    std::move(*proc)
-                ),
-                loc
-            );
-        } else {
-            return std::make_unique<Proc>(
-                IdentifierProc(
-                    Identifier(std::move(subject)),
-                    std::vector<Identifier>()
-                ),
-                loc
-            );
-        }
-    }
+            auto id2 = parse_identifier();
+            if (!id2) return std::nullopt;
 
-    // [ a = b ] UnaryProc
-    if (token_type == TokenType::OPENING_BRACKET) {
-        skip();
-        auto id1 = parse_identifier();
-        if (!id1) return std::nullopt;
+            if (!skip_if_equal(TokenType::CLOSING_BRACKET)) {
+                return expected("a ] at the end of the match clause");
+            }
 
-        if (!skip_if_equal(TokenType::EQUALS)) {
-            return expected("an = sign in match clause");
+            pending.push_back(PendingProc { ProcKind::MATCH, { (*id1).symbol, (*id2).symbol }, 0, loc, false });
+            continue;
         }
 
-        auto id2 = parse_identifier();
-        if (!id2) return std::nullopt;
-
-        if (!skip_if_equal(TokenType::CLOSING_BRACKET)) {
-            return expected("a ] at the end of the match clause");
+        // 0
+        if (token_type == TokenType::NUMBER) {
+            if (get_token().value != "0") {
+                return syntax_error("The only number that can be used as a process is 0");
+            }
+            skip();
+            return module.add_proc(ProcKind::ZERO, 0, { 0, 0 }, loc);
         }
 
-        auto proc = parse_unary_proc();
-        if (!proc) return std::nullopt;
+        // ( ^ a ) UnaryProc
+        // ( Proc )
+        if (token_type == TokenType::OPENING_PAREN) {
+            skip();
 
-        return std::make_unique<Proc>(
-            MatchProc(std::move(*id1), std::move(*id2), std::move(*proc)),
-            loc
-        );
-    }
-
-    // 0
-    if (token_type == TokenType::NUMBER) {
-        if (get_token().value != "0") {
-            return syntax_error("The only number that can be used as a process is 0");
-        }
-        skip();
-        return std::make_unique<Proc>(ZeroProc(), loc);
-    }
-
-    // ( ^ a ) UnaryProc
-    // ( Proc )
-    if (token_type == TokenType::OPENING_PAREN) {
-        skip();
+            if (skip_if_equal(TokenType::CIRCONFLEX)) {
+                auto name = parse_identifier();
+                if (!name) return std::nullopt;
 
-        if (skip_if_equal(TokenType::CIRCONFLEX)) {
-            auto name = parse_identifier();
-            if (!name) return std::nullopt;
+                if (!skip_if_equal(TokenType::CLOSING_PAREN)) {
+                    return expected("`)` symbol in a restriction process");
+                }
 
-            if (!skip_if_equal(TokenType::CLOSING_PAREN)) {
-                return expected("`)` symbol in a restriction process");
+                pending.push_back(PendingProc { ProcKind::RESTRICTION, { (*name).symbol, 0 }, 0, loc, false });
+                continue;
             }
 
-            auto proc = parse_unary_proc();
-            if (!proc) return std::nullopt;
-
-            return std::make_unique<Proc>(
-                RestrictionProc(std::move(*name), std::move(*proc)),
-                loc
-            );
-        }
-
-        auto proc = parse_proc();
-        if (!proc) return std::nullopt;
-
-        if (!skip_if_equal(TokenType::CLOSING_PAREN)) {
-            return expected("closing `)`");
+            pending.push_back(PendingProc { ProcKind::ZERO, { 0, 0 }, 0, loc, true });
+            continue;
         }
 
-        return proc;
+        return expected("a process");
     }
-
-    return expected("a process");
 }
 
 std::optional<Identifier> Parser::parse_identifier() {
@@ -331,7 +334,7 @@ std::optional<Identifier> Parser::parse_identifier() {
     auto token = get_token();
     if (token.token_type == TokenType::IDENTIFIER) {
         skip();
-        return Identifier(token.value);
+        return Identifier(token.symbol, token.value);
     } else {
         return expected("an identifier");
     }
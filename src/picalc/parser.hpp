@@ -5,14 +5,31 @@
 #include "core.hpp"
 #include "lexer.hpp"
 
+#include <array>
 #include <vector>
 
 namespace picalc {
 
-Expected<Module> parse_module(std::vector<Token> tokens);
+// the tokens and the module are allocated in `arena`; the module takes over
+// the symbols of the identifiers
+Expected<Module> parse_module(ArenaVector<Token> tokens, SymbolTable symbols, Arena& arena);
+
+// A node that waits for its last child while parsing: a prefix waits for its
+// suffix, and a sum or parallel composition for its last operand. An opening
+// parenthesis waits for the closing one.
+struct PendingProc final {
+    ProcKind kind;
+    std::array<Symbol, 2> names;
+    size_t first_operand; // in Parser::operands
+    SourceLocation loc;
+    bool paren;
+};
 
 struct Parser final {
-    explicit Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) {}
+    explicit Parser(ArenaVector<Token> tokens, SymbolTable symbols, Arena& arena) :
+        tokens(std::move(tokens)),
+        arena(arena),
+        module(std::move(symbols), arena) {}
 
     std::vector<Error> errors;
 
@@ -20,17 +37,23 @@ struct Parser final {
 
     std::optional<ProcDecl> parse_proc_decl();
 
-    std::optional<std::unique_ptr<Proc>> parse_proc();
+    std::optional<ProcIndex> parse_proc();
 
 private:
-    std::vector<Token> tokens;
+    ArenaVector<Token> tokens;
     size_t index = 0;
+    Arena& arena;
+    Module module; // the nodes parsed so far
+    std::vector<PendingProc> pending; // the explicit stack of parse_proc
+    std::vector<ProcIndex> operands; // of the pending sums and parallel compositions
+
+    std::optional<ArenaVector<Identifier>> parse_arg_list();
 
-    std::optional<std::vector<Identifier>> parse_arg_list();
+    std::optional<ProcIndex> parse_prefixes();
 
-    std::optional<std::unique_ptr<Proc>> parse_parallel_proc();
+    void add_operand(ProcKind kind, ProcIndex operand);
 
-    std::optional<std::unique_ptr<Proc>> parse_unary_proc();
+    ProcIndex add_pending(const PendingProc& proc, ProcIndex last);
 
     std::optional<Identifier> parse_identifier();
 
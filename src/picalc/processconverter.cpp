@@ -0,0 +1,772 @@
+#include "processconverter.hpp"
+
+#include <algorithm>
+
+namespace picalc {
+
+static void add_indentation(ProcessConverterState& state) {
+    if (state.indentation_string.empty()) return;
+    for (int i = 0; i < state.indentation_counter; i++) {
+        state.output += state.indentation_string;
+    }
+}
+
+static std::optional<std::string> get_bound_name(
+    const Identifier& id,
+    SourceLocation loc,
+    ProcessConverterState& state
+) {
+    auto& scopes = state.name_map[id.symbol];
+    if (scopes.empty()) {
+        state.errors.push_back(Error {
+            ErrorType::IDENTIFIER,
+            loc,
+            "Unbound name `" + std::string(id.value) + "`"
+        });
+        return std::nullopt;
+    }
+    return scopes.back();
+}
+
+// binds `id` to `value`; returns the value
+static std::string add_bound_name(
+    const Identifier& id,
+    std::string value,
+    ProcessConverterState& state
+) {
+    state.name_map[id.symbol].push_back(value);
+    return value;
+}
+
+static void remove_bound_name(const Identifier& id, ProcessConverterState& state) {
+    state.name_map[id.symbol].pop_back();
+}
+
+static std::optional<int> get_declaration(
+    const Module& mod,
+    const IdentifierProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state
+) {
+    auto var = state.variable_map[proc.variable_id.symbol];
+    if (!var.has_value()) {
+        state.errors.push_back(Error(
+            ErrorType::IDENTIFIER,
+            loc,
+            "Unknown recursion variable `" + std::string(proc.variable_id.value) + "`"
+        ));
+        return std::nullopt;
+    }
+
+    auto& decl = mod.declarations[*var];
+    if (decl.params.size() != proc.args.size()) {
+        state.errors.push_back(Error(
+            ErrorType::IDENTIFIER,
+            loc,
+            "Agent `" + std::string(proc.variable_id.value) + "` expects " +
+                std::to_string(decl.params.size()) + " arguments"
+        ));
+        return std::nullopt;
+    }
+    return var;
+}
+
+static std::optional<std::vector<std::string>> get_arguments(
+    const IdentifierProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state
+) {
+    std::vector<std::string> args;
+    bool error = false;
+    for (auto arg : proc.args) {
+        auto name = get_bound_name(arg, loc, state);
+        if (!name) {
+            error = true;
+            continue;
+        }
+        args.push_back(std::move(*name));
+    }
+    if (error) return std::nullopt;
+    return args;
+}
+
+static std::string get_process_call(const std::string& process, const std::vector<std::string>& args) {
+    std::string result = process;
+    if (args.size() > 0) {
+        result += "(";
+        for (int i = 0; i < args.size(); i++) {
+            if (i > 0) {
+                result += ", ";
+            }
+            result += args[i];
+        }
+        result += ")";
+    }
+    return result;
+}
+
+// The overloads below decide whether a node is sequential from the results
+// of its children in `procs`; see get_sequential_procs.
+static bool is_sequential_proc(
+    const ZeroProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    return true;
+}
+
+static bool is_sequential_proc(
+    const TauPrefixProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    return procs[proc.proc];
+}
+
+static bool is_sequential_proc(
+    const PositivePrefixProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    return procs[proc.proc];
+}
+
+static bool is_sequential_proc(
+    const NegativePrefixProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    return procs[proc.proc];
+}
+
+static bool is_sequential_proc(
+    const MatchProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    return procs[proc.proc];
+}
+
+static bool is_sequential_proc(
+    const RestrictionProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    return false;
+}
+
+static bool is_sequential_proc(
+    const SumProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    for (auto operand : proc.operands) {
+        if (!procs[operand]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_sequential_proc(
+    const ParallelProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    return false;
+}
+
+static bool is_sequential_proc(
+    const IdentifierProc& proc,
+    const std::vector<bool>& procs,
+    const ProcessConverterState& state
+) {
+    auto var = state.variable_map[proc.variable_id.symbol];
+    // unknown variables are reported during conversion
+    return !var.has_value() || state.sequential[*var];
+}
+
+// per node: whether it only uses prefixes, sums, matches and calls of
+// sequential agents; the loop visits the children of a node before it
+static std::vector<bool> get_sequential_procs(const Module& mod, const ProcessConverterState& state) {
+    std::vector<bool> procs(mod.kinds.size());
+    for (ProcIndex proc = 0; proc < mod.kinds.size(); proc++) {
+        procs[proc] = mod.visit<bool>(proc, [&](auto& arg) {
+            return is_sequential_proc(arg, procs, state);
+        });
+    }
+    return procs;
+}
+
+// The work that waits for the children of a node, on an explicit stack like
+// MCRL2Task in mcrl2converter.cpp, so that the depth of a process is only
+// limited by memory. The tasks run in the reverse order of pushing.
+struct ProcessTask final {
+    enum class Kind {
+        PROC, // convert the process `operand`
+        NEXT_OPERAND, // between the operands of a sum
+        CLOSE, // the end of a node with its suffix on its own lines
+        UNBIND, // the end of the scope of the symbol `operand`
+        UNBIND_INPUT, // the same for the object of an input, whose number is free again
+        RETURN // the end of an agent unfolded outside of prefixes
+    };
+
+    Kind kind;
+    uint32_t operand;
+};
+
+using ProcessTasks = std::vector<ProcessTask>;
+
+static void convert_sequential_prefix(
+    const std::string& action,
+    ProcIndex suffix,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    state.output += action;
+    state.output += " .\n";
+    add_indentation(state);
+    tasks.push_back(ProcessTask { ProcessTask::Kind::PROC, suffix });
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const ZeroProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    state.output += "delta";
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const TauPrefixProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    convert_sequential_prefix("tau", proc.proc, state, tasks);
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const PositivePrefixProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    auto subject_name = get_bound_name(proc.subject, loc, state);
+    if (!subject_name) return;
+
+    auto object_name = add_bound_name(proc.object, "n" + std::to_string(state.name_counter++), state);
+
+    state.output += "(sum ";
+    state.output += object_name;
+    state.output += ": PiName . (";
+    state.output += object_name;
+    state.output += " in pi_names || ";
+    state.output += object_name;
+    state.output += " in pi_private_names) ->\n";
+    state.indentation_counter++;
+    add_indentation(state);
+    tasks.push_back(ProcessTask { ProcessTask::Kind::UNBIND_INPUT, proc.object.symbol });
+    tasks.push_back(ProcessTask { ProcessTask::Kind::CLOSE, 0 });
+    convert_sequential_prefix(
+        "pi_receive(" + *subject_name + ", " + object_name + ")",
+        proc.proc,
+        state,
+        tasks
+    );
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const NegativePrefixProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    auto subject_name = get_bound_name(proc.subject, loc, state);
+    auto object_name = get_bound_name(proc.object, loc, state);
+    if (!subject_name || !object_name) return;
+
+    convert_sequential_prefix(
+        "pi_send(" + *subject_name + ", " + *object_name + ")",
+        proc.proc,
+        state,
+        tasks
+    );
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const MatchProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    auto matched_name1 = get_bound_name(proc.name1, loc, state);
+    auto matched_name2 = get_bound_name(proc.name2, loc, state);
+    if (!matched_name1 || !matched_name2) return;
+
+    state.output += "((";
+    state.output += *matched_name1;
+    state.output += " == ";
+    state.output += *matched_name2;
+    state.output += ") ->\n";
+    state.indentation_counter++;
+    add_indentation(state);
+    tasks.push_back(ProcessTask { ProcessTask::Kind::CLOSE, 0 });
+    tasks.push_back(ProcessTask { ProcessTask::Kind::PROC, proc.proc });
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const RestrictionProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    state.errors.push_back(Error(
+        ErrorType::UNSUPPORTED,
+        loc,
+        "The process target does not support restrictions under a prefix or sum"
+    ));
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const SumProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    // nested to the left, like the binary sums the parser used to produce
+    for (size_t i = 1; i < proc.operands.size(); i++) {
+        state.output += "(\n";
+        state.indentation_counter++;
+        add_indentation(state);
+    }
+    for (size_t i = proc.operands.size() - 1; i >= 1; i--) {
+        tasks.push_back(ProcessTask { ProcessTask::Kind::CLOSE, 0 });
+        tasks.push_back(ProcessTask { ProcessTask::Kind::PROC, proc.operands[i] });
+        tasks.push_back(ProcessTask { ProcessTask::Kind::NEXT_OPERAND, 0 });
+    }
+    tasks.push_back(ProcessTask { ProcessTask::Kind::PROC, proc.operands[0] });
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const ParallelProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    state.errors.push_back(Error(
+        ErrorType::UNSUPPORTED,
+        loc,
+        "The process target does not support parallel compositions under a prefix or sum"
+    ));
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    const IdentifierProc& proc,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    auto index = get_declaration(mod, proc, loc, state);
+    auto args = get_arguments(proc, loc, state);
+    if (!index || !args) return;
+
+    if (!state.sequential[*index]) {
+        state.errors.push_back(Error(
+            ErrorType::UNSUPPORTED,
+            loc,
+            "The process target cannot call `" + std::string(proc.variable_id.value) +
+                "` under a prefix or sum, because it uses parallel composition or restriction"
+        ));
+        return;
+    }
+
+    state.output += get_process_call("P_" + std::string(proc.variable_id.value), *args);
+}
+
+static void convert_sequential_proc(
+    const Module& mod,
+    ProcIndex root,
+    ProcessConverterState& state
+) {
+    ProcessTasks tasks { ProcessTask { ProcessTask::Kind::PROC, root } };
+    while (!tasks.empty()) {
+        auto task = tasks.back();
+        tasks.pop_back();
+        switch (task.kind) {
+            case ProcessTask::Kind::PROC: {
+                auto loc = mod.get_loc(task.operand);
+                mod.visit<void>(task.operand, [&](auto& arg) {
+                    convert_sequential_proc(mod, arg, loc, state, tasks);
+                });
+                break;
+            }
+            case ProcessTask::Kind::NEXT_OPERAND:
+                state.indentation_counter--;
+                state.output += "\n";
+                add_indentation(state);
+                state.output += "+\n";
+                state.indentation_counter++;
+                add_indentation(state);
+                break;
+            case ProcessTask::Kind::CLOSE:
+                state.indentation_counter--;
+                state.output += "\n";
+                add_indentation(state);
+                state.output += ")";
+                break;
+            case ProcessTask::Kind::UNBIND_INPUT:
+                state.name_counter--;
+                [[fallthrough]];
+            case ProcessTask::Kind::UNBIND:
+                state.name_map[task.operand].pop_back();
+                break;
+            case ProcessTask::Kind::RETURN:
+                break;
+        }
+    }
+}
+
+// a sequential part outside of any prefix becomes its own process equation
+static void add_static_component(const Module& mod, ProcIndex proc, ProcessConverterState& state) {
+    std::string component = "C_" + std::to_string(state.components.size());
+    state.components.push_back(component);
+
+    state.output += "proc ";
+    state.output += component;
+    state.output += " =\n";
+    state.indentation_counter++;
+    add_indentation(state);
+    state.name_counter = 0;
+    convert_sequential_proc(mod, proc, state);
+    state.indentation_counter--;
+    state.output += ";\n\n";
+}
+
+static void convert_static_proc(
+    const Module& mod,
+    const ZeroProc& proc,
+    ProcIndex outer,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {}
+
+template <typename T>
+static void convert_static_proc(
+    const Module& mod,
+    const T& proc,
+    ProcIndex outer,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    add_static_component(mod, outer, state);
+}
+
+static void convert_static_proc(
+    const Module& mod,
+    const MatchProc& proc,
+    ProcIndex outer,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    auto matched_name1 = get_bound_name(proc.name1, mod.get_loc(outer), state);
+    auto matched_name2 = get_bound_name(proc.name2, mod.get_loc(outer), state);
+    if (!matched_name1 || !matched_name2) return;
+
+    // all names outside of prefixes are known, so the match can be decided now
+    if (*matched_name1 == *matched_name2) {
+        tasks.push_back(ProcessTask { ProcessTask::Kind::PROC, proc.proc });
+    }
+}
+
+static void convert_static_proc(
+    const Module& mod,
+    const RestrictionProc& proc,
+    ProcIndex outer,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    int private_name = state.public_names + state.private_names++;
+    add_bound_name(proc.name, std::to_string(private_name), state);
+    tasks.push_back(ProcessTask { ProcessTask::Kind::UNBIND, proc.name.symbol });
+    tasks.push_back(ProcessTask { ProcessTask::Kind::PROC, proc.proc });
+}
+
+static void convert_static_proc(
+    const Module& mod,
+    const ParallelProc& proc,
+    ProcIndex outer,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    for (size_t i = proc.operands.size(); i-- > 0;) {
+        tasks.push_back(ProcessTask { ProcessTask::Kind::PROC, proc.operands[i] });
+    }
+}
+
+static void convert_static_call(
+    const Module& mod,
+    int index,
+    const std::vector<std::string>& args,
+    SourceLocation loc,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    auto& decl = mod.declarations[index];
+    if (state.sequential[index]) {
+        state.components.push_back(get_process_call("P_" + std::string(decl.id.value), args));
+        return;
+    }
+
+    if (std::find(state.inlining.begin(), state.inlining.end(), index) != state.inlining.end()) {
+        state.errors.push_back(Error(
+            ErrorType::UNSUPPORTED,
+            loc,
+            "The process target does not support recursion through parallel composition or restriction"
+        ));
+        return;
+    }
+
+    // unfold the agent with its parameters bound to the (fixed) arguments,
+    // until the RETURN task restores the names of the caller
+    state.caller_names.push_back(std::move(state.name_map));
+    state.name_map.assign(mod.symbols.size(), {});
+    for (int i = 0; i < decl.params.size(); i++) {
+        add_bound_name(decl.params[i], args[i], state);
+    }
+    state.inlining.push_back(index);
+    tasks.push_back(ProcessTask { ProcessTask::Kind::RETURN, 0 });
+    tasks.push_back(ProcessTask { ProcessTask::Kind::PROC, decl.proc });
+}
+
+static void convert_static_proc(
+    const Module& mod,
+    const IdentifierProc& proc,
+    ProcIndex outer,
+    ProcessConverterState& state,
+    ProcessTasks& tasks
+) {
+    auto loc = mod.get_loc(outer);
+    auto index = get_declaration(mod, proc, loc, state);
+    auto args = get_arguments(proc, loc, state);
+    if (!index || !args) return;
+
+    convert_static_call(mod, *index, *args, loc, state, tasks);
+}
+
+// unfolds the call of agent `index` outside of prefixes into components
+static void convert_static_proc(
+    const Module& mod,
+    int index,
+    const std::vector<std::string>& args,
+    SourceLocation loc,
+    ProcessConverterState& state
+) {
+    ProcessTasks tasks;
+    convert_static_call(mod, index, args, loc, state, tasks);
+    while (!tasks.empty()) {
+        auto task = tasks.back();
+        tasks.pop_back();
+        switch (task.kind) {
+            case ProcessTask::Kind::PROC:
+                mod.visit<void>(task.operand, [&](auto& arg) {
+                    convert_static_proc(mod, arg, task.operand, state, tasks);
+                });
+                break;
+            case ProcessTask::Kind::UNBIND:
+                state.name_map[task.operand].pop_back();
+                break;
+            case ProcessTask::Kind::RETURN:
+                state.inlining.pop_back();
+                state.name_map = std::move(state.caller_names.back());
+                state.caller_names.pop_back();
+                break;
+            case ProcessTask::Kind::NEXT_OPERAND:
+            case ProcessTask::Kind::CLOSE:
+            case ProcessTask::Kind::UNBIND_INPUT:
+                break;
+        }
+    }
+}
+
+static void convert_decl_to_process(
+    const ProcDecl& decl,
+    const Module& mod,
+    ProcessConverterState& state
+) {
+    std::vector<std::string> params;
+    state.name_counter = 0;
+    for (auto& id : decl.params) {
+        params.push_back(add_bound_name(id, "n" + std::to_string(state.name_counter++), state));
+    }
+
+    state.output += "proc P_";
+    state.output += decl.id.value;
+    if (decl.params.size() > 0) {
+        state.output += "(";
+        for (int i = 0; i < params.size(); i++) {
+            if (i > 0) {
+                state.output += ", ";
+            }
+            state.output += params[i];
+            state.output += ": PiName";
+        }
+        state.output += ")";
+    }
+    state.output += " =\n";
+    state.indentation_counter++;
+    add_indentation(state);
+    convert_sequential_proc(mod, decl.proc, state);
+    state.indentation_counter--;
+    state.output += ";\n\n";
+
+    for (int i = decl.params.size() - 1; i >= 0; i--) {
+        remove_bound_name(decl.params[i], state);
+    }
+}
+
+void convert_module_to_mcrl2_processes(const Module& mod, ProcessConverterState& state) {
+    state.name_map.resize(mod.symbols.size());
+    state.variable_map.resize(mod.symbols.size());
+    std::optional<int> main_index;
+
+    bool error = false;
+    for (int i = 0; i < mod.declarations.size(); i++) {
+        auto& decl = mod.declarations[i];
+        auto& var = state.variable_map[decl.id.symbol];
+        if (var.has_value()) {
+            state.errors.push_back(Error {
+                ErrorType::IDENTIFIER,
+                decl.loc,
+                "Duplicate process variable name"
+            });
+            error = true;
+        }
+        var = i;
+
+        if (decl.id.value == "Main") {
+            main_index = i;
+        }
+    }
+
+    if (!main_index.has_value()) {
+        state.errors.push_back(Error {
+            ErrorType::IDENTIFIER,
+            SourceLocation(0, 0),
+            "No starting process found; it should be called `Main`"
+        });
+        error = true;
+    }
+
+    if (error) return;
+
+    // greatest fixed point: an agent is sequential if it only calls sequential agents
+    state.sequential.assign(mod.declarations.size(), true);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        auto procs = get_sequential_procs(mod, state);
+        for (int i = 0; i < mod.declarations.size(); i++) {
+            if (state.sequential[i] && !procs[mod.declarations[i].proc]) {
+                state.sequential[i] = false;
+                changed = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < mod.declarations.size(); i++) {
+        if (state.sequential[i]) {
+            convert_decl_to_process(mod.declarations[i], mod, state);
+        }
+    }
+
+    // Main's parameters are the public names 0, ..., arity - 1; restrictions
+    // outside of prefixes get the private names after all public ones
+    auto& main_decl = mod.declarations[*main_index];
+    std::vector<std::string> main_args;
+    for (int i = 0; i < main_decl.params.size(); i++) {
+        main_args.push_back(std::to_string(i));
+    }
+    convert_static_proc(mod, *main_index, main_args, main_decl.loc, state);
+
+    std::string header;
+    header += "eqn pi_names = { name': PiName | name' < ";
+    header += std::to_string(state.public_names);
+    header += " };\n";
+    header += "eqn pi_private_names = { name': PiName | ";
+    header += std::to_string(state.public_names);
+    header += " <= name' && name' < ";
+    header += std::to_string(state.public_names + state.private_names);
+    header += " };\n\n";
+    state.output = header + state.output;
+
+    state.output += "init\n";
+    state.indentation_counter++;
+    add_indentation(state);
+    state.output += "hide({pi_sync},\n";
+    add_indentation(state);
+    state.output += "allow({pi_sync, pi_output, pi_input},\n";
+    add_indentation(state);
+    state.output += "comm({pi_send | env_output -> pi_output, pi_receive | env_input -> pi_input},\n";
+    state.indentation_counter++;
+    add_indentation(state);
+    state.output += "comm({pi_send | pi_receive -> pi_sync},\n";
+    state.indentation_counter++;
+    if (state.components.size() == 0) {
+        add_indentation(state);
+        state.output += "delta";
+    }
+    for (int i = 0; i < state.components.size(); i++) {
+        if (i > 0) {
+            state.output += " ||\n";
+        }
+        add_indentation(state);
+        state.output += state.components[i];
+    }
+    state.output += "\n";
+    state.indentation_counter--;
+    add_indentation(state);
+    state.output += ") ||\n";
+    add_indentation(state);
+    state.output += "PiEnvironment({";
+    for (int i = 0; i < main_decl.params.size(); i++) {
+        if (i > 0) {
+            state.output += ", ";
+        }
+        state.output += std::to_string(i);
+    }
+    state.output += "})\n";
+    state.indentation_counter--;
+    add_indentation(state);
+    state.output += ")));\n";
+    state.indentation_counter--;
+}
+
+Expected<std::string> convert_module_to_mcrl2_processes(const Module& mod, int names_bound, bool compact) {
+    ProcessConverterState state {
+        compact ? "" : "    ",
+        0,
+        "",
+        std::vector<Error>(),
+    };
+    state.public_names = names_bound;
+    convert_module_to_mcrl2_processes(mod, state);
+
+    if (state.errors.size() > 0) {
+        return Expected<std::string>(std::move(state.errors));
+    }
+
+    return std::move(state.output);
+}
+
+} // end namespace picalc
@@ -0,0 +1,38 @@
+#ifndef PICALC_PROCESSCONVERTER_H
+#define PICALC_PROCESSCONVERTER_H
+
+#include "ast.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace picalc {
+
+struct ProcessConverterState {
+    std::string indentation_string;
+    int indentation_counter;
+    std::string output;
+    std::vector<Error> errors;
+    std::vector<std::vector<std::string>> name_map; // per symbol: data expressions of the enclosing binders
+    std::vector<std::optional<int>> variable_map; // per symbol: the index of its declaration
+    std::vector<bool> sequential; // per declaration: can it be a process equation
+    std::vector<int> inlining; // declarations being unfolded outside of prefixes
+    std::vector<std::vector<std::vector<std::string>>> caller_names; // per unfolded declaration: the caller's name_map
+    std::vector<std::string> components;
+    int name_counter;
+    int public_names; // pi_names = { name': PiName | name' < public_names }
+    int private_names;
+};
+
+// Compiles every agent that only uses prefixes, sums, matches and calls into a
+// process equation `P_<name>`. Parallel compositions and restrictions are only
+// supported outside of prefixes, where they are unfolded statically into
+// components `C_<i>` and fixed private names.
+void convert_module_to_mcrl2_processes(const Module& module, ProcessConverterState& state);
+
+// With `compact`, nothing is indented.
+Expected<std::string> convert_module_to_mcrl2_processes(const Module& module, int names_bound, bool compact);
+
+} // end namespace picalc
+
+#endif
@@ -0,0 +1,17 @@
+#include "symbols.hpp"
+
+namespace picalc {
+
+Identifier SymbolTable::intern(std::string_view text) {
+    auto it = symbols.find(text);
+    if (it != symbols.end()) {
+        return Identifier(it->second, texts[it->second]);
+    }
+
+    Symbol symbol = texts.size();
+    texts.push_back(text);
+    symbols.emplace(text, symbol);
+    return Identifier(symbol, text);
+}
+
+} // end namespace picalc
@@ -0,0 +1,40 @@
+#ifndef PICALC_SYMBOLS_H
+#define PICALC_SYMBOLS_H
+
+#include "arena.hpp"
+#include "core.hpp"
+
+#include <string_view>
+#include <unordered_map>
+
+namespace picalc {
+
+// Interns identifiers while lexing. Every distinct identifier is hashed once
+// and is a dense Symbol from then on, so the parser and the converters can
+// keep per-identifier data in flat arrays. The texts are views into the input.
+class SymbolTable final {
+public:
+    explicit SymbolTable(Arena& arena) : texts(arena) {}
+
+    SymbolTable(SymbolTable&& rhs) = default;
+    SymbolTable& operator=(SymbolTable&& rhs) = default;
+
+    Identifier intern(std::string_view text);
+
+    std::string_view get_text(Symbol symbol) const {
+        return texts[symbol];
+    }
+
+    // symbols are 0, ..., size() - 1
+    size_t size() const {
+        return texts.size();
+    }
+
+private:
+    std::unordered_map<std::string_view, Symbol> symbols;
+    ArenaVector<std::string_view> texts;
+};
+
+} // end namespace picalc
+
+#endif
@@ -0,0 +1,57 @@
+#include "transitioncache.hpp"
+
+namespace picalc {
+
+TransitionCache::TransitionCache(size_t capacity)
+    : shard_capacity((capacity + NUM_SHARDS - 1) / NUM_SHARDS),
+      shards(new Shard[NUM_SHARDS]) {}
+
+std::optional<std::vector<PiTransition>> TransitionCache::find(const AgentPtr& agent) {
+    auto& shard = shards[AgentPtrHash()(agent) % NUM_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(agent);
+    if (it == shard.index.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    auto& entry = shard.entries[it->second];
+    entry.referenced = true;
+    return entry.transitions;
+}
+
+void TransitionCache::insert(const AgentPtr& agent, const std::vector<PiTransition>& transitions) {
+    auto& shard = shards[AgentPtrHash()(agent) % NUM_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // another thread may have computed the same transitions in the meantime
+    if (shard_capacity == 0 || shard.index.find(agent) != shard.index.end()) {
+        return;
+    }
+
+    if (shard.entries.size() < shard_capacity) {
+        shard.index[agent] = shard.entries.size();
+        shard.entries.push_back(Entry { agent, transitions, false });
+        return;
+    }
+
+    while (shard.entries[shard.hand].referenced) {
+        shard.entries[shard.hand].referenced = false;
+        shard.hand = (shard.hand + 1) % shard.entries.size();
+    }
+
+    auto& victim = shard.entries[shard.hand];
+    shard.index.erase(victim.agent);
+    evictions.fetch_add(1, std::memory_order_relaxed);
+
+    victim = Entry { agent, transitions, false };
+    shard.index[agent] = shard.hand;
+    shard.hand = (shard.hand + 1) % shard.entries.size();
+}
+
+CacheStatistics TransitionCache::get_statistics() const {
+    return CacheStatistics { hits.load(), misses.load(), evictions.load() };
+}
+
+} // end namespace picalc
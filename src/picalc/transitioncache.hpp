@@ -0,0 +1,57 @@
+#ifndef PICALC_TRANSITIONCACHE_H
+#define PICALC_TRANSITIONCACHE_H
+
+#include "explorer.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace picalc {
+
+// A bounded map from agents to their outgoing transitions. Since agents are
+// interned, a subterm that occurs in many states is one key, and the
+// transitions of a parallel composition only have to be recomputed for the
+// component that changed.
+//
+// Every shard evicts with the clock algorithm: an entry that was used since
+// the hand last passed it gets a second chance.
+class TransitionCache final {
+public:
+    explicit TransitionCache(size_t capacity);
+
+    std::optional<std::vector<PiTransition>> find(const AgentPtr& agent);
+
+    void insert(const AgentPtr& agent, const std::vector<PiTransition>& transitions);
+
+    CacheStatistics get_statistics() const;
+
+private:
+    static constexpr size_t NUM_SHARDS = 64;
+
+    struct Entry {
+        AgentPtr agent;
+        std::vector<PiTransition> transitions;
+        bool referenced;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<AgentPtr, size_t, AgentPtrHash> index; // agent to entry
+        std::vector<Entry> entries;
+        size_t hand = 0;
+    };
+
+    size_t shard_capacity;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<size_t> hits { 0 };
+    std::atomic<size_t> misses { 0 };
+    std::atomic<size_t> evictions { 0 };
+};
+
+} // end namespace picalc
+
+#endif
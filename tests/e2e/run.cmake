@@ -0,0 +1,131 @@
+# Runs pi2mcrl2 on a model of tests/e2e; see add_e2e_test in CMakeLists.txt.
+#
+#   MODE=output    compares the output file with EXPECTED
+#   MODE=error     expects a failure, and compares the errors with EXPECTED
+#   MODE=accepted  only expects pi2mcrl2 to succeed
+#   MODE=equal     explores the model with ARGS and with REFERENCE (by default
+#                  no options), and expects the same labels and the same
+#                  numbers of states and transitions
+#   MODE=fewer     like equal, but allows fewer states and transitions
+#   MODE=same      like equal, but expects the very same .aut file
+#
+# OUTPUT replaces the output file in WORK_DIR, e.g. with a device.
+
+cmake_minimum_required(VERSION 3.20)
+
+set(options "${ARGS}")
+set(reference_options "${REFERENCE}")
+if(reference_options STREQUAL "")
+    set(reference_options "plain")
+endif()
+separate_arguments(ARGS)
+separate_arguments(REFERENCE)
+get_filename_component(name "${EXPECTED}" NAME)
+set(output "${WORK_DIR}/${name}")
+if(DEFINED OUTPUT AND NOT OUTPUT STREQUAL "")
+    set(output "${OUTPUT}")
+endif()
+
+function(run_pi2mcrl2 output)
+    execute_process(
+        COMMAND "${PI2MCRL2}" "${MODEL}" ${ARGN} -o "${output}"
+        RESULT_VARIABLE result
+        ERROR_VARIABLE errors
+    )
+    set(result "${result}" PARENT_SCOPE)
+    set(errors "${errors}" PARENT_SCOPE)
+endfunction()
+
+# the number of states and transitions, and the sorted labels of an .aut file
+function(read_aut file)
+    file(STRINGS "${file}" lines)
+    list(GET lines 0 header)
+    if(NOT header MATCHES "^des \\(0,([0-9]+),([0-9]+)\\)$")
+        message(FATAL_ERROR "${file}: not an .aut file")
+    endif()
+    set(transitions "${CMAKE_MATCH_1}" PARENT_SCOPE)
+    set(states "${CMAKE_MATCH_2}" PARENT_SCOPE)
+
+    set(labels "")
+    foreach(line IN LISTS lines)
+        if(line MATCHES "^\\([0-9]+,\"([^\"]*)\",[0-9]+\\)$")
+            list(APPEND labels "${CMAKE_MATCH_1}")
+        endif()
+    endforeach()
+    list(REMOVE_DUPLICATES labels)
+    list(SORT labels)
+    set(labels "${labels}" PARENT_SCOPE)
+endfunction()
+
+if(MODE STREQUAL "output")
+    run_pi2mcrl2("${output}" ${ARGS})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "pi2mcrl2 failed:\n${errors}")
+    endif()
+    execute_process(
+        COMMAND "${CMAKE_COMMAND}" -E compare_files "${output}" "${EXPECTED}"
+        RESULT_VARIABLE different
+    )
+    if(different)
+        message(FATAL_ERROR "${output} differs from ${EXPECTED}")
+    endif()
+
+elseif(MODE STREQUAL "accepted")
+    run_pi2mcrl2("${output}" ${ARGS})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "pi2mcrl2 failed:\n${errors}")
+    endif()
+
+elseif(MODE STREQUAL "error")
+    run_pi2mcrl2("${output}" ${ARGS})
+    if(result EQUAL 0)
+        message(FATAL_ERROR "pi2mcrl2 accepted the model")
+    endif()
+    file(READ "${EXPECTED}" expected_errors)
+    if(NOT errors STREQUAL expected_errors)
+        message(FATAL_ERROR "expected the errors\n${expected_errors}but got\n${errors}")
+    endif()
+
+elseif(MODE STREQUAL "equal" OR MODE STREQUAL "fewer" OR MODE STREQUAL "same")
+    run_pi2mcrl2("${output}.reference.aut" --explore ${REFERENCE})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "pi2mcrl2 ${reference_options} failed:\n${errors}")
+    endif()
+    run_pi2mcrl2("${output}.aut" --explore ${ARGS})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "pi2mcrl2 ${options} failed:\n${errors}")
+    endif()
+
+    if(MODE STREQUAL "same")
+        execute_process(
+            COMMAND "${CMAKE_COMMAND}" -E compare_files "${output}.aut" "${output}.reference.aut"
+            RESULT_VARIABLE different
+        )
+        if(different)
+            message(FATAL_ERROR "${output}.aut differs from ${output}.reference.aut")
+        endif()
+        return()
+    endif()
+
+    read_aut("${output}.reference.aut")
+    set(reference_states "${states}")
+    set(reference_transitions "${transitions}")
+    set(reference_labels "${labels}")
+    read_aut("${output}.aut")
+
+    message(STATUS "${reference_options}: ${reference_states} states, ${reference_transitions} transitions")
+    message(STATUS "${options}: ${states} states, ${transitions} transitions")
+    if(NOT labels STREQUAL reference_labels)
+        message(FATAL_ERROR "the labels differ:\n  ${reference_options}: ${reference_labels}\n  ${options}: ${labels}")
+    endif()
+    if(MODE STREQUAL "equal")
+        if(NOT states EQUAL reference_states OR NOT transitions EQUAL reference_transitions)
+            message(FATAL_ERROR "expected the same number of states and transitions")
+        endif()
+    elseif(states GREATER reference_states OR transitions GREATER reference_transitions)
+        message(FATAL_ERROR "expected at most as many states and transitions")
+    endif()
+
+else()
+    message(FATAL_ERROR "unknown MODE `${MODE}`")
+endif()